@@ -0,0 +1,187 @@
+// Writes a synthetic Coral program to stdout, for measuring compiler
+// throughput. The program only has to compile, not compute anything
+// meaningful, but it uses every construct the parser knows so that
+// each phase of the compiler gets exercised. Output depends only on
+// the options, so runs with equal options compare the same input.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <getopt.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+    struct Options {
+	unsigned functions = 1000;
+	// Conditions in each if/elseif chain.
+	unsigned ifChain = 4;
+	// Operands in each generated expression.
+	unsigned exprTerms = 8;
+	// Depth of the for loop nest in each function.
+	unsigned loopDepth = 2;
+	uint32_t seed = 1;
+    };
+
+    class Generator {
+	const Options & m_options;
+	std::ostream & m_out;
+	uint32_t m_state;
+	unsigned m_nextVar;
+
+	// xorshift32, rather than <random>, whose distributions may
+	// differ between standard libraries.
+	unsigned Random(const unsigned n) {
+	    m_state ^= m_state << 13;
+	    m_state ^= m_state >> 17;
+	    m_state ^= m_state << 5;
+	    return m_state % n;
+	}
+
+	std::string NewVar() {
+	    return "v" + std::to_string(m_nextVar++);
+	}
+
+	void Indent(const unsigned depth) {
+	    m_out << std::string(depth * 4, ' ');
+	}
+
+	std::string Operand(const std::vector<std::string> & vars) {
+	    if (!vars.empty() && Random(3) != 0) {
+		return vars[Random(vars.size())];
+	    }
+	    return std::to_string(Random(1000));
+	}
+
+	// An int expression of the given number of operands. Division
+	// and modulus only ever take non-zero literals on the right.
+	std::string Expr(const unsigned terms, const std::vector<std::string> & vars) {
+	    std::string expr = Operand(vars);
+	    for (unsigned i = 1; i < terms; ++i) {
+		switch (Random(6)) {
+		case 0: expr += " + " + Operand(vars); break;
+		case 1: expr += " - " + Operand(vars); break;
+		case 2: expr += " * " + Operand(vars); break;
+		case 3: expr += " / " + std::to_string(1 + Random(9)); break;
+		case 4: expr += " % " + std::to_string(1 + Random(9)); break;
+		default: expr = "(" + expr + ") + " + Operand(vars); break;
+		}
+	    }
+	    return expr;
+	}
+
+	void Decl(const unsigned depth, std::vector<std::string> & vars) {
+	    const auto name = NewVar();
+	    Indent(depth);
+	    m_out << "var " << name << " = " << Expr(m_options.exprTerms, vars) << ";\n";
+	    vars.push_back(name);
+	}
+
+	void LoopNest(const unsigned depth, const unsigned remaining,
+		      std::vector<std::string> vars) {
+	    if (remaining == 0) {
+		Decl(depth, vars);
+		return;
+	    }
+	    const auto loopVar = NewVar();
+	    Indent(depth);
+	    // Inner loops run up to the enclosing loop's variable.
+	    const std::string bound = depth > 1 ? vars.back() : "100";
+	    m_out << "for " << loopVar << " in 0.." << bound << " do\n";
+	    vars.push_back(loopVar);
+	    LoopNest(depth + 1, remaining - 1, vars);
+	    Indent(depth);
+	    m_out << "end\n";
+	}
+
+	void IfChain(const unsigned depth, std::vector<std::string> vars) {
+	    if (m_options.ifChain == 0) {
+		return;
+	    }
+	    const auto & subject = vars.back();
+	    for (unsigned i = 0; i < m_options.ifChain; ++i) {
+		Indent(depth);
+		m_out << (i == 0 ? "if " : "elseif ") << subject << " == " << i << " then\n";
+		auto scopeVars = vars;
+		Decl(depth + 1, scopeVars);
+	    }
+	    Indent(depth);
+	    m_out << "else\n";
+	    Decl(depth + 1, vars);
+	    Indent(depth);
+	    m_out << "end\n";
+	}
+
+    public:
+	Generator(const Options & options, std::ostream & out) :
+	    m_options(options), m_out(out), m_state(options.seed ? options.seed : 1),
+	    m_nextVar(0) {}
+
+	void Function(const unsigned index) {
+	    std::vector<std::string> vars;
+	    m_nextVar = 0;
+	    m_out << "def f" << index << "()\n";
+	    Decl(1, vars);
+	    Decl(1, vars);
+	    LoopNest(1, m_options.loopDepth, vars);
+	    IfChain(1, vars);
+	    Indent(1);
+	    m_out << "return " << vars.back() << ";\n"
+		  << "end\n\n";
+	}
+
+	void Program() {
+	    for (unsigned i = 0; i < m_options.functions; ++i) {
+		Function(i);
+	    }
+	    m_out << "def main()\n"
+		  << "    return 0;\n"
+		  << "end\n";
+	}
+    };
+
+    void PrintUsage(const char * exec) {
+	std::cerr << "usage: " << exec << " [options] > program.crl\n"
+		  << "options:\n"
+		  << "  --functions=<n>   number of functions (default 1000)\n"
+		  << "  --if-chain=<n>    conditions per if/elseif chain (default 4)\n"
+		  << "  --expr-terms=<n>  operands per expression (default 8)\n"
+		  << "  --loop-depth=<n>  depth of each function's for loop nest (default 2)\n"
+		  << "  --seed=<n>        random seed (default 1)\n";
+    }
+}
+
+int main(int argc, char ** argv) {
+    Options options;
+    enum {
+	OPT_FUNCTIONS = 256,
+	OPT_IF_CHAIN,
+	OPT_EXPR_TERMS,
+	OPT_LOOP_DEPTH,
+	OPT_SEED
+    };
+    static const option longOptions[] = {
+	{"functions", required_argument, nullptr, OPT_FUNCTIONS},
+	{"if-chain", required_argument, nullptr, OPT_IF_CHAIN},
+	{"expr-terms", required_argument, nullptr, OPT_EXPR_TERMS},
+	{"loop-depth", required_argument, nullptr, OPT_LOOP_DEPTH},
+	{"seed", required_argument, nullptr, OPT_SEED},
+	{nullptr, 0, nullptr, 0}
+    };
+    int opt;
+    while ((opt = getopt_long_only(argc, argv, "", longOptions, nullptr)) != -1) {
+	const unsigned value = optarg ? std::strtoul(optarg, nullptr, 10) : 0;
+	switch (opt) {
+	case OPT_FUNCTIONS: options.functions = value; break;
+	case OPT_IF_CHAIN: options.ifChain = value; break;
+	case OPT_EXPR_TERMS: options.exprTerms = std::max(1u, value); break;
+	case OPT_LOOP_DEPTH: options.loopDepth = value; break;
+	case OPT_SEED: options.seed = value; break;
+	default:
+	    PrintUsage(argv[0]);
+	    return EXIT_FAILURE;
+	}
+    }
+    Generator(options, std::cout).Program();
+}
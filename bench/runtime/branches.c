@@ -0,0 +1,27 @@
+// Equivalent of branches.crl.
+int kernel(void) {
+    for (int i = 0; i < 3000; i++) {
+        for (int j = 0; j < 3000; j++) {
+            int x = (i * 7919 + j * 104729) % 100000007;
+            int r = x % 4;
+            if (r == 0) {
+                if (x / 4 == 12345671) {
+                    return 1;
+                }
+            } else if (r == 1) {
+                if (x * 3 % 100000007 == 23456781) {
+                    return 2;
+                }
+            } else if (r == 2) {
+                if (x - x % 1000 == 34567891) {
+                    return 3;
+                }
+            } else {
+                if (x + 777 == 85540668) {
+                    return i * 3000 + j;
+                }
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,32 @@
+// Calls a kernel, compiled from either Coral or C, several times and
+// prints its result and the fastest run in milliseconds. The kernel
+// lives in another object file, so its result can't be computed at
+// compile time and hoisted out of the timing loop.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+int kernel(void);
+
+static double Milliseconds(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1000.0 + time.tv_nsec / 1e6;
+}
+
+int main(int argc, char ** argv) {
+    const int repetitions = argc > 1 ? atoi(argv[1]) : 5;
+    double best = 0;
+    int result = 0;
+    for (int i = 0; i < repetitions; ++i) {
+	const double start = Milliseconds();
+	result = kernel();
+	const double elapsed = Milliseconds() - start;
+	if (i == 0 || elapsed < best) {
+	    best = elapsed;
+	}
+    }
+    printf("%d %.3f\n", result, best);
+    return 0;
+}
@@ -0,0 +1,13 @@
+// Equivalent of loops.crl. Coral ints wrap, so the hash is unsigned.
+int kernel(void) {
+    unsigned hash = 0;
+    for (int i = 10; i < 10000; i++) {
+        for (int j = 0; j < i; j++) {
+            hash = hash * 3 + j;
+        }
+        for (int j = 0; j < i; j++) {
+            hash = hash * 5 - j;
+        }
+    }
+    return (int)hash;
+}
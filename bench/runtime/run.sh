@@ -0,0 +1,51 @@
+#!/bin/sh
+# Times the code coralc generates for each kernel in this directory
+# against the same kernel written in C and compiled by clang, at every
+# optimization level. Each kernel.crl has a kernel.c next to it that
+# must return the same result.
+#
+# usage: run.sh <coralc> [repetitions]
+#
+# CC selects the C compiler (default clang) and OUT the directory for
+# the built binaries (default bench-results/runtime).
+
+set -e
+
+if [ $# -lt 1 ]; then
+    echo "usage: $0 <coralc> [repetitions]" >&2
+    exit 1
+fi
+CORALC=$1
+REPETITIONS=${2:-5}
+CC=${CC:-clang}
+DIR=$(cd "$(dirname "$0")" && pwd)
+OUT=${OUT:-bench-results/runtime}
+mkdir -p "$OUT"
+
+$CC -O2 -c "$DIR/harness.c" -o "$OUT/harness.o"
+printf '%-10s %-4s %12s %12s %8s\n' kernel opt "coral (ms)" "C (ms)" ratio
+status=0
+for source in "$DIR"/*.crl; do
+    name=$(basename "$source" .crl)
+    for opt in 0 1 2 3; do
+	coral="$OUT/$name-coral-O$opt"
+	c="$OUT/$name-c-O$opt"
+	"$CORALC" -O$opt -o "$coral.o" "$source"
+	$CC "$OUT/harness.o" "$coral.o" -o "$coral"
+	$CC -O$opt -c "$DIR/$name.c" -o "$c.o"
+	$CC "$OUT/harness.o" "$c.o" -o "$c"
+	set -- $("$coral" "$REPETITIONS")
+	coralResult=$1
+	coralTime=$2
+	set -- $("$c" "$REPETITIONS")
+	cResult=$1
+	cTime=$2
+	ratio=$(awk "BEGIN { if ($cTime > 0) printf \"%.2f\", $coralTime / $cTime; else print \"-\" }")
+	printf '%-10s -O%-2s %12s %12s %8s\n' "$name" "$opt" "$coralTime" "$cTime" "$ratio"
+	if [ "$coralResult" != "$cResult" ]; then
+	    echo "$name -O$opt: coral returned $coralResult, C returned $cResult" >&2
+	    status=1
+	fi
+    done
+done
+exit $status
@@ -0,0 +1,12 @@
+// Equivalent of search.crl.
+int kernel(void) {
+    for (int i = 0; i < 3000; i++) {
+        for (int j = 0; j < 3000; j++) {
+            int x = (i * 7919 + j * 104729) % 100000007;
+            if (x == 9781229) {
+                return i * 3000 + j;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,20 @@
+// Equivalent of sieve.crl.
+#include <stdbool.h>
+#include <stdlib.h>
+
+int kernel(void) {
+    const int n = 2000000;
+    bool * composite = calloc(n, sizeof(bool));
+    int count = 0;
+    for (int i = 2; i < n; i++) {
+        if (!composite[i]) {
+            count++;
+            const int m = (n - 1) / i + 1;
+            for (int k = i; k < m; k++) {
+                composite[i * k] = true;
+            }
+        }
+    }
+    free(composite);
+    return count;
+}
@@ -0,0 +1,149 @@
+#include "Backend.hpp"
+
+#include "llvm/ADT/Triple.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/MC/SubtargetFeature.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Target/TargetOptions.h"
+#include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include "llvm/Transforms/Scalar.h"
+#include <stdexcept>
+
+namespace coralc {
+    static llvm::CodeGenOpt::Level GetCodeGenOptLevel(const unsigned optLevel) {
+	switch (optLevel) {
+	case 0: return llvm::CodeGenOpt::None;
+	case 1: return llvm::CodeGenOpt::Less;
+	case 2: return llvm::CodeGenOpt::Default;
+	default: return llvm::CodeGenOpt::Aggressive;
+	}
+    }
+
+    std::string GetTargetCPU(const CompileOptions & options) {
+	if (options.cpu == "native") {
+	    return llvm::sys::getHostCPUName().str();
+	}
+	return options.cpu;
+    }
+
+    std::string GetTargetFeatures(const CompileOptions & options) {
+	llvm::SubtargetFeatures features;
+	if (options.cpu == "native") {
+	    llvm::StringMap<bool> hostFeatures;
+	    if (llvm::sys::getHostCPUFeatures(hostFeatures)) {
+		for (auto & feature : hostFeatures) {
+		    features.AddFeature(feature.first(), feature.second);
+		}
+	    }
+	}
+	for (auto & attr : llvm::SubtargetFeatures(options.features).getFeatures()) {
+	    features.AddFeature(attr);
+	}
+	return features.getString();
+    }
+
+    void InitializeTarget(const std::string & triple) {
+	std::string error;
+	if (!llvm::InitializeNativeTarget() &&
+	    !llvm::InitializeNativeTargetAsmPrinter() &&
+	    !llvm::InitializeNativeTargetAsmParser() &&
+	    llvm::TargetRegistry::lookupTarget(triple, error)) {
+	    return;
+	}
+	llvm::InitializeAllTargetInfos();
+	llvm::InitializeAllTargets();
+	llvm::InitializeAllTargetMCs();
+	llvm::InitializeAllAsmParsers();
+	llvm::InitializeAllAsmPrinters();
+    }
+
+    std::unique_ptr<llvm::TargetMachine>
+    CreateTargetMachine(const std::string & triple, const CompileOptions & options,
+			const bool forJit) {
+	std::string error;
+	auto target = llvm::TargetRegistry::lookupTarget(triple, error);
+	if (!target) {
+	    throw std::runtime_error(error);
+	}
+	auto CPU = GetTargetCPU(options);
+	auto features = GetTargetFeatures(options);
+	llvm::TargetOptions opt;
+	auto RM = llvm::Optional<llvm::Reloc::Model>();
+	return std::unique_ptr<llvm::TargetMachine>(
+	    target->createTargetMachine(triple, CPU, features, opt, RM,
+					forJit ? llvm::CodeModel::JITDefault
+					: llvm::CodeModel::Default,
+					GetCodeGenOptLevel(options.optLevel)));
+    }
+
+    void Optimize(llvm::Module & module, llvm::TargetMachine & targetMachine,
+		  const CompileOptions & options) {
+	if (options.optLevel == 0) {
+	    return;
+	}
+	llvm::Triple triple(module.getTargetTriple());
+	llvm::PassManagerBuilder builder;
+	builder.OptLevel = options.optLevel;
+	builder.SizeLevel = 0;
+	builder.LibraryInfo = new llvm::TargetLibraryInfoImpl(triple);
+	if (options.optLevel > 1) {
+	    builder.Inliner = llvm::createFunctionInliningPass(options.optLevel, 0);
+	}
+	builder.LoopVectorize = options.optLevel > 1;
+	builder.SLPVectorize = options.optLevel > 1;
+	llvm::legacy::FunctionPassManager fnPasses(&module);
+	fnPasses.add(llvm::createTargetTransformInfoWrapperPass(
+			 targetMachine.getTargetIRAnalysis()));
+	llvm::legacy::PassManager modulePasses;
+	modulePasses.add(new llvm::TargetLibraryInfoWrapperPass(triple));
+	modulePasses.add(llvm::createTargetTransformInfoWrapperPass(
+			     targetMachine.getTargetIRAnalysis()));
+	builder.populateFunctionPassManager(fnPasses);
+	builder.populateModulePassManager(modulePasses);
+	fnPasses.doInitialization();
+	for (auto & fn : module) {
+	    fnPasses.run(fn);
+	}
+	fnPasses.doFinalization();
+	modulePasses.run(module);
+    }
+
+    void OptimizeLinked(llvm::Module & module, llvm::TargetMachine & targetMachine,
+			const CompileOptions & options) {
+	// Optimize only inlines from -O2 up, so below that the
+	// partitions already are what one module would give.
+	if (options.optLevel < 2) {
+	    return;
+	}
+	llvm::Triple triple(module.getTargetTriple());
+	llvm::legacy::PassManager passes;
+	passes.add(new llvm::TargetLibraryInfoWrapperPass(triple));
+	passes.add(llvm::createTargetTransformInfoWrapperPass(
+		       targetMachine.getTargetIRAnalysis()));
+	passes.add(llvm::createFunctionInliningPass(options.optLevel, 0));
+	// Function passes added after the inliner run on each function
+	// as soon as the calls in it have been inlined.
+	passes.add(llvm::createSROAPass());
+	passes.add(llvm::createEarlyCSEPass());
+	passes.add(llvm::createInstructionCombiningPass());
+	passes.add(llvm::createCFGSimplificationPass());
+	passes.add(llvm::createGlobalDCEPass());
+	passes.run(module);
+    }
+
+    bool EmitMachineCode(llvm::Module & module, llvm::TargetMachine & targetMachine,
+			 llvm::raw_pwrite_stream & dest,
+			 const llvm::TargetMachine::CodeGenFileType fileType) {
+	llvm::legacy::PassManager pass;
+	if (targetMachine.addPassesToEmitFile(pass, dest, fileType)) {
+	    return false;
+	}
+	pass.run(module);
+	return true;
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+
+namespace coralc {
+    struct CompileOptions {
+	// Mirrors the -O flags of clang: 0 disables the IR pipeline
+	// entirely, 3 enables the most aggressive inlining and unrolling.
+	unsigned optLevel = 2;
+	// "native" selects the host CPU and enables every feature the
+	// host reports; the -mattr string is applied on top of that.
+	std::string cpu = "generic";
+	std::string features;
+	// Set by --target. Defaults to the triple LLVM was configured
+	// for, which is normally the host's.
+	std::string triple = llvm::sys::getDefaultTargetTriple();
+    };
+
+    // Registers the backend that generates code for the triple, which
+    // must happen before any TargetMachine is created. Only the host's
+    // backend is initialized when it can handle the triple; the others
+    // are initialized on demand, since setting up every backend LLVM
+    // was built with dominates the startup time of small compiles.
+    // Not thread safe.
+    void InitializeTarget(const std::string & triple);
+
+    // The CPU name and feature string handed to the target, with
+    // "native" resolved to what the host reports.
+    std::string GetTargetCPU(const CompileOptions &);
+    std::string GetTargetFeatures(const CompileOptions &);
+
+    // Pass forJit when the machine will be handed to the in-process
+    // JIT, which needs the JIT flavour of the default code model.
+    std::unique_ptr<llvm::TargetMachine>
+    CreateTargetMachine(const std::string & triple, const CompileOptions &,
+			const bool forJit = false);
+
+    // Runs the standard function and module level pipelines (SROA,
+    // instcombine, GVN, LICM, unrolling, vectorization, ...) for the
+    // requested optimization level. The module's data layout and
+    // triple must already match the target machine.
+    void Optimize(llvm::Module &, llvm::TargetMachine &, const CompileOptions &);
+
+    // Runs the interprocedural passes again on a module linked from
+    // separately optimized partitions, so that calls between them are
+    // inlined and functions left unused are removed, and cleans up the
+    // functions inlined into.
+    void OptimizeLinked(llvm::Module &, llvm::TargetMachine &, const CompileOptions &);
+
+    // Lowers the module to an object or assembly file. Returns false
+    // if the target cannot emit files of the requested type.
+    bool EmitMachineCode(llvm::Module &, llvm::TargetMachine &, llvm::raw_pwrite_stream &,
+			 const llvm::TargetMachine::CodeGenFileType);
+}
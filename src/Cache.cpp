@@ -0,0 +1,230 @@
+#include "Cache.hpp"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cstdio>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <stdexcept>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <vector>
+
+namespace coralc {
+    static const char * statsFileName = "stats";
+    static const char * entrySuffix = ".out";
+
+    static bool CopyFile(const std::string & from, const std::string & to) {
+	std::ifstream in(from, std::ios::binary);
+	if (!in) {
+	    return false;
+	}
+	std::ofstream out(to, std::ios::binary | std::ios::trunc);
+	out << in.rdbuf();
+	return static_cast<bool>(out);
+    }
+
+    static std::vector<std::string> ListEntries(const std::string & directory) {
+	std::vector<std::string> entries;
+	if (DIR * dir = opendir(directory.c_str())) {
+	    while (const dirent * entry = readdir(dir)) {
+		if (llvm::StringRef(entry->d_name).endswith(entrySuffix)) {
+		    entries.push_back(directory + "/" + entry->d_name);
+		}
+	    }
+	    closedir(dir);
+	}
+	return entries;
+    }
+
+    // Identifies a build of the compiler by its executable's file
+    // identity, size and modification time, all of which change when
+    // it is relinked. Hashing the executable's contents would cost
+    // more than most compiles the cache saves.
+    static std::string GetCompilerId(const std::string & compilerPath) {
+	struct stat status;
+	if (compilerPath.empty() || stat(compilerPath.c_str(), &status) != 0) {
+	    throw std::runtime_error("Could not identify the compiler executable " +
+				     compilerPath + " to key the cache by");
+	}
+	return std::to_string(status.st_dev) + ":" + std::to_string(status.st_ino) + ":" +
+	    std::to_string(status.st_size) + ":" + std::to_string(status.st_mtim.tv_sec) + "." +
+	    std::to_string(status.st_mtim.tv_nsec);
+    }
+
+    CompilationCache::CompilationCache(const std::string & directory,
+				       const uint64_t maxSize,
+				       const std::string & compilerPath) :
+	m_directory(directory), m_maxSize(maxSize),
+	m_compilerId(GetCompilerId(compilerPath)) {
+	if (llvm::sys::fs::create_directories(directory)) {
+	    throw std::runtime_error("Could not create cache directory " + directory);
+	}
+    }
+
+    std::string CompilationCache::GetKey(llvm::StringRef source, const CompileOptions & options,
+					 llvm::StringRef outputKind) const {
+	llvm::MD5 hash;
+	// Each field is followed by a NUL so that adjacent fields can't
+	// run together into the same byte sequence.
+	auto AddField = [&hash](llvm::StringRef field) {
+	    hash.update(field);
+	    hash.update(llvm::StringRef("", 1));
+	};
+	AddField(m_compilerId);
+	AddField(options.triple);
+	AddField(GetTargetCPU(options));
+	AddField(GetTargetFeatures(options));
+	AddField(std::to_string(options.optLevel));
+	AddField(outputKind);
+	hash.update(source);
+	llvm::MD5::MD5Result result;
+	hash.final(result);
+	llvm::SmallString<32> key;
+	llvm::MD5::stringifyResult(result, key);
+	return key.str().str();
+    }
+
+    std::string CompilationCache::GetEntryPath(const std::string & key) const {
+	return m_directory + "/" + key + entrySuffix;
+    }
+
+    void CompilationCache::CountLookup(const bool hit) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (hit) {
+	    ++m_stats.hits;
+	} else {
+	    ++m_stats.misses;
+	}
+    }
+
+    bool CompilationCache::Lookup(const std::string & key, const std::string & outputName) {
+	const auto path = this->GetEntryPath(key);
+	const bool hit = CopyFile(path, outputName);
+	if (hit) {
+	    // The modification time doubles as the last use time that
+	    // eviction orders entries by.
+	    utimes(path.c_str(), nullptr);
+	}
+	this->CountLookup(hit);
+	return hit;
+    }
+
+    bool CompilationCache::LookupBuffer(const std::string & key,
+					llvm::SmallVectorImpl<char> & data) {
+	const auto path = this->GetEntryPath(key);
+	auto buffer = llvm::MemoryBuffer::getFile(path);
+	const bool hit = static_cast<bool>(buffer);
+	if (hit) {
+	    data.assign((*buffer)->getBufferStart(), (*buffer)->getBufferEnd());
+	    utimes(path.c_str(), nullptr);
+	}
+	this->CountLookup(hit);
+	return hit;
+    }
+
+    void CompilationCache::Store(const std::string & key, const std::string & outputName) {
+	if (auto buffer = llvm::MemoryBuffer::getFile(outputName)) {
+	    this->StoreBuffer(key, (*buffer)->getBuffer());
+	}
+    }
+
+    void CompilationCache::StoreBuffer(const std::string & key, llvm::StringRef data) {
+	int fd;
+	llvm::SmallString<128> tempPath;
+	if (llvm::sys::fs::createUniqueFile(m_directory + "/%%%%%%%%.tmp", fd, tempPath)) {
+	    return;
+	}
+	llvm::raw_fd_ostream os(fd, true);
+	os << data;
+	os.close();
+	// A cache that can't be written to only costs the next build
+	// time, so failures here are not reported.
+	if (os.has_error() ||
+	    std::rename(tempPath.c_str(), this->GetEntryPath(key).c_str()) != 0) {
+	    os.clear_error();
+	    llvm::sys::fs::remove(tempPath);
+	}
+    }
+
+    uint64_t CompilationCache::GetSize() const {
+	uint64_t size = 0;
+	for (auto & path : ListEntries(m_directory)) {
+	    struct stat info;
+	    if (stat(path.c_str(), &info) == 0) {
+		size += info.st_size;
+	    }
+	}
+	return size;
+    }
+
+    void CompilationCache::Finish() {
+	struct Entry {
+	    std::string path;
+	    uint64_t size;
+	    time_t lastUse;
+	};
+	std::vector<Entry> entries;
+	uint64_t size = 0;
+	for (auto & path : ListEntries(m_directory)) {
+	    struct stat info;
+	    if (stat(path.c_str(), &info) == 0) {
+		entries.push_back({path, static_cast<uint64_t>(info.st_size), info.st_mtime});
+		size += info.st_size;
+	    }
+	}
+	if (size > m_maxSize) {
+	    std::sort(entries.begin(), entries.end(), [](const Entry & a, const Entry & b) {
+		    return a.lastUse < b.lastUse;
+		});
+	    for (auto & entry : entries) {
+		if (size <= m_maxSize) {
+		    break;
+		}
+		if (!llvm::sys::fs::remove(entry.path)) {
+		    size -= entry.size;
+		    ++m_stats.evictions;
+		}
+	    }
+	}
+	// Other compilers may be updating the totals at the same time.
+	const auto statsPath = m_directory + "/" + statsFileName;
+	const int fd = open(statsPath.c_str(), O_RDWR | O_CREAT, 0644);
+	if (fd < 0) {
+	    return;
+	}
+	flock(fd, LOCK_EX);
+	CacheStats totals;
+	char buffer[128] = {};
+	if (read(fd, buffer, sizeof(buffer) - 1) > 0) {
+	    unsigned long long hits, misses, evictions;
+	    if (sscanf(buffer, "%llu %llu %llu", &hits, &misses, &evictions) == 3) {
+		totals.hits = hits;
+		totals.misses = misses;
+		totals.evictions = evictions;
+	    }
+	}
+	const auto line = std::to_string(totals.hits + m_stats.hits) + " " +
+	    std::to_string(totals.misses + m_stats.misses) + " " +
+	    std::to_string(totals.evictions + m_stats.evictions) + "\n";
+	if (ftruncate(fd, 0) == 0) {
+	    pwrite(fd, line.data(), line.size(), 0);
+	}
+	flock(fd, LOCK_UN);
+	close(fd);
+    }
+
+    CacheStats CompilationCache::GetTotalStats() const {
+	CacheStats totals;
+	std::ifstream in(m_directory + "/" + statsFileName);
+	in >> totals.hits >> totals.misses >> totals.evictions;
+	return totals;
+    }
+}
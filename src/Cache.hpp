@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "Backend.hpp"
+
+namespace coralc {
+    struct CacheStats {
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	uint64_t evictions = 0;
+    };
+
+    // A directory of compiler outputs named by a hash of everything that
+    // determines their contents: the compiler binary, the source bytes,
+    // the target triple, CPU and features, the optimization level and
+    // the kind of output.
+    // Entries are written to a temporary file and renamed into place,
+    // so concurrent compilers sharing a directory never observe a
+    // partial entry. Lookup and Store may be called from any thread.
+    class CompilationCache {
+	std::string m_directory;
+	uint64_t m_maxSize;
+	// Changes whenever the compiler is rebuilt, so that outputs of
+	// another build are never reused.
+	std::string m_compilerId;
+	std::mutex m_mutex;
+	CacheStats m_stats;
+	std::string GetEntryPath(const std::string & key) const;
+	void CountLookup(const bool hit);
+    public:
+	// compilerPath is the running coralc executable.
+	CompilationCache(const std::string & directory, const uint64_t maxSize,
+			 const std::string & compilerPath);
+	std::string GetKey(llvm::StringRef source, const CompileOptions &,
+			   llvm::StringRef outputKind) const;
+	// Copies the entry for key to outputName. Returns false on a miss.
+	bool Lookup(const std::string & key, const std::string & outputName);
+	void Store(const std::string & key, const std::string & outputName);
+	// The same for outputs kept in memory.
+	bool LookupBuffer(const std::string & key, llvm::SmallVectorImpl<char> & data);
+	void StoreBuffer(const std::string & key, llvm::StringRef data);
+	// Deletes the least recently used entries until the directory is
+	// no larger than maxSize, then adds this run's counters to the
+	// totals kept in the directory. Call once, after the last Store.
+	void Finish();
+	// The counters of this run.
+	const CacheStats & GetStats() const {
+	    return m_stats;
+	}
+	// The totals over every run that has used the directory.
+	CacheStats GetTotalStats() const;
+	uint64_t GetSize() const;
+	uint64_t GetMaxSize() const {
+	    return m_maxSize;
+	}
+    };
+}
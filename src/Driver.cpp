@@ -0,0 +1,530 @@
+#include "Driver.hpp"
+
+#include "llvm/Linker/Linker.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Program.h"
+#include "llvm/Support/ThreadPool.h"
+#include "Cache.hpp"
+#include "Jit.hpp"
+#include "Parser.hpp"
+#include "TimeReport.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace coralc {
+    static const char * GetOutputExtension(const DriverOptions::Action action) {
+	switch (action) {
+	case DriverOptions::Action::EmitAssembly: return "s";
+	case DriverOptions::Action::EmitLLVM: return "ll";
+	case DriverOptions::Action::EmitBitcode: return "bc";
+	default: return "o";
+	}
+    }
+
+    static std::string GetOutputName(const std::string & fname,
+				     const DriverOptions & driverOptions) {
+	if (!driverOptions.outputName.empty()) {
+	    return driverOptions.outputName;
+	}
+	return fname + "." + GetOutputExtension(driverOptions.action);
+    }
+
+    static void EmitOutput(llvm::Module & module, llvm::TargetMachine & targetMachine,
+			  const std::string & outputName,
+			  const DriverOptions::Action action) {
+	std::error_code EC;
+	const auto flags = action == DriverOptions::Action::EmitLLVM ||
+	    action == DriverOptions::Action::EmitAssembly ?
+	    llvm::sys::fs::F_Text : llvm::sys::fs::F_None;
+	llvm::raw_fd_ostream dest(outputName, EC, flags);
+	if (EC) {
+	    throw std::runtime_error("Could not open file: " + EC.message());
+	}
+	switch (action) {
+	case DriverOptions::Action::EmitLLVM:
+	    module.print(dest, nullptr);
+	    break;
+
+	case DriverOptions::Action::EmitBitcode:
+	    llvm::WriteBitcodeToFile(&module, dest);
+	    break;
+
+	default: {
+	    auto FileType = action == DriverOptions::Action::EmitAssembly ?
+		llvm::TargetMachine::CGFT_AssemblyFile :
+		llvm::TargetMachine::CGFT_ObjectFile;
+	    if (!EmitMachineCode(module, targetMachine, dest, FileType)) {
+		throw std::runtime_error("TheTargetMachine can't emit a file of this type");
+	    }
+	} break;
+	}
+	dest.flush();
+    }
+
+    using Clock = std::chrono::steady_clock;
+
+    static double MillisecondsSince(const Clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // Compiles the module with the JIT and calls the entry function
+    // in-process. Returns the entry's result when it returns an int, so
+    // that --run behaves like executing the linked binary.
+    static int RunCode(std::unique_ptr<llvm::Module> module,
+		       std::unique_ptr<llvm::TargetMachine> targetMachine,
+		       const std::string & entry, const Clock::time_point compileStart,
+		       TimeReport * report) {
+	auto fn = module->getFunction(entry);
+	if (!fn || fn->isDeclaration()) {
+	    throw std::runtime_error("Entry function " + entry + " not found");
+	}
+	if (!fn->arg_empty()) {
+	    throw std::runtime_error("Entry function " + entry + " takes parameters");
+	}
+	auto returnType = fn->getReturnType();
+	std::unique_ptr<Jit> jit;
+	void * address;
+	{
+	    PhaseTimer timer(report, TimeReport::Phase::Emit);
+	    jit.reset(new Jit(std::move(module), std::move(targetMachine)));
+	    address = jit->GetFunctionAddress(entry);
+	}
+	const double compileTime = MillisecondsSince(compileStart);
+	int exitCode = EXIT_SUCCESS;
+	std::string result;
+	const auto execStart = Clock::now();
+	if (returnType->isIntegerTy(32)) {
+	    exitCode = reinterpret_cast<int32_t (*)()>(address)();
+	    result = std::to_string(exitCode);
+	} else if (returnType->isIntegerTy(8)) {
+	    result = reinterpret_cast<int8_t (*)()>(address)() ? "true" : "false";
+	} else if (returnType->isFloatTy()) {
+	    result = std::to_string(reinterpret_cast<float (*)()>(address)());
+	} else {
+	    reinterpret_cast<void (*)()>(address)();
+	    result = "void";
+	}
+	const double execTime = MillisecondsSince(execStart);
+	std::cerr << entry << " returned " << result << "\n"
+		  << "compile time: " << compileTime << " ms\n"
+		  << "execution time: " << execTime << " ms" << std::endl;
+	return exitCode;
+    }
+
+    // A contiguous run of top level functions, lowered, optimized and
+    // possibly emitted on its own thread with its own LLVMContext.
+    struct Partition {
+	std::unique_ptr<LLVMState> state;
+	std::unique_ptr<llvm::TargetMachine> targetMachine;
+	llvm::SmallVector<char, 0> object;
+	std::string error;
+    };
+
+    // Objects can't simply be concatenated, so partitions emitted in
+    // parallel are combined with a relocatable link into one object.
+    static void LinkObjects(const std::string & linker, std::vector<Partition> & partitions,
+			    const std::string & outputName) {
+	std::vector<std::string> objectFiles;
+	std::string error;
+	for (auto & partition : partitions) {
+	    int fd;
+	    llvm::SmallString<128> path;
+	    if (llvm::sys::fs::createTemporaryFile("coralc-partition", "o", fd, path)) {
+		error = "Could not create temporary object file";
+		break;
+	    }
+	    llvm::raw_fd_ostream os(fd, true);
+	    os << llvm::StringRef(partition.object.data(), partition.object.size());
+	    objectFiles.push_back(path.str().str());
+	}
+	if (error.empty()) {
+	    std::vector<const char *> args = {
+		linker.c_str(), "-r", "-o", outputName.c_str()
+	    };
+	    for (auto & objectFile : objectFiles) {
+		args.push_back(objectFile.c_str());
+	    }
+	    args.push_back(nullptr);
+	    std::string linkError;
+	    if (llvm::sys::ExecuteAndWait(linker, args.data(), nullptr, nullptr,
+					  0, 0, &linkError) != 0) {
+		error = "Failed to link partitions: " + linkError;
+	    }
+	}
+	for (auto & objectFile : objectFiles) {
+	    llvm::sys::fs::remove(objectFile);
+	}
+	if (!error.empty()) {
+	    throw std::runtime_error(error);
+	}
+    }
+
+    // Moves every partition's module into the first partition's
+    // context. Modules can't be shared between contexts, so each one
+    // takes a round trip through an in-memory bitcode buffer.
+    static void MergePartitions(std::vector<Partition> & partitions) {
+	auto & state = *partitions.front().state;
+	for (size_t i = 1; i < partitions.size(); ++i) {
+	    llvm::SmallVector<char, 0> bitcode;
+	    llvm::raw_svector_ostream os(bitcode);
+	    llvm::WriteBitcodeToFile(partitions[i].state->modRef.get(), os);
+	    partitions[i].targetMachine.reset();
+	    partitions[i].state.reset();
+	    llvm::MemoryBufferRef buffer(llvm::StringRef(bitcode.data(), bitcode.size()),
+					 "partition");
+	    auto module = llvm::parseBitcodeFile(buffer, state.context);
+	    if (!module) {
+		throw std::runtime_error("__Internal error: failed to reload partition");
+	    }
+	    if (llvm::Linker::linkModules(*state.modRef, std::move(*module))) {
+		throw std::runtime_error("__Internal error: failed to link partition");
+	    }
+	}
+	partitions.resize(1);
+    }
+
+    // Per function cache entries hold the function's module after
+    // optimization, as bitcode.
+    static bool LookupModule(CompilationCache & cache, const std::string & key,
+			     LLVMState & state) {
+	llvm::SmallVector<char, 0> bitcode;
+	if (!cache.LookupBuffer(key, bitcode)) {
+	    return false;
+	}
+	// Named like the module LLVMState creates, which the loaded one
+	// replaces.
+	llvm::MemoryBufferRef buffer(llvm::StringRef(bitcode.data(), bitcode.size()), "top");
+	auto module = llvm::parseBitcodeFile(buffer, state.context);
+	if (!module) {
+	    return false;
+	}
+	state.modRef = std::move(*module);
+	return true;
+    }
+
+    static void StoreModule(CompilationCache & cache, const std::string & key,
+			    llvm::Module & module) {
+	llvm::SmallVector<char, 0> bitcode;
+	llvm::raw_svector_ostream os(bitcode);
+	llvm::WriteBitcodeToFile(&module, os);
+	cache.StoreBuffer(key, llvm::StringRef(bitcode.data(), bitcode.size()));
+    }
+
+    int GenerateCode(ast::NodeRef & root, const std::string & fname,
+		     const CompileOptions & options, const DriverOptions & driverOptions,
+		     CompilationCache * cache, TimeReport * report) {
+	const auto compileStart = Clock::now();
+	const auto topLevel = llvm::cast<ast::Scope>(*root).GetChildren();
+	if (report) {
+	    report->AddCount(&TimeReport::Counts::functions,
+			     std::count_if(topLevel.begin(), topLevel.end(),
+					   [](const ast::NodeRef & node) {
+					       return llvm::isa<ast::Function>(node.get());
+					   }));
+	}
+	const auto & targetTriple = options.triple;
+	const bool run = driverOptions.action == DriverOptions::Action::Run;
+	auto outputName = GetOutputName(fname, driverOptions);
+	unsigned jobs = driverOptions.jobs;
+	if (jobs == 0) {
+	    jobs = std::max(1u, std::thread::hardware_concurrency());
+	}
+	// Incremental builds put every function in a partition of its
+	// own, so that each can be found in the cache on its own.
+	const bool incremental = cache && driverOptions.incremental &&
+	    driverOptions.printIR == DriverOptions::PrintIR::None;
+	const size_t partitionCount = incremental ?
+	    std::max<size_t>(1, topLevel.size()) :
+	    std::max<size_t>(1, std::min<size_t>(jobs, topLevel.size()));
+	const size_t threadCount = std::min<size_t>(jobs, partitionCount);
+	std::vector<Partition> partitions(partitionCount);
+	// Objects emitted separately and combined with ld -r can't be
+	// optimized across partitions, so that is only done below -O2,
+	// where OptimizeLinked has nothing to do anyway.
+	std::string linker;
+	if (partitionCount > 1 && driverOptions.action == DriverOptions::Action::EmitObject &&
+	    outputName != "-" && options.optLevel < 2) {
+	    if (auto ld = llvm::sys::findProgramByName("ld")) {
+		linker = *ld;
+	    }
+	}
+	const bool emitInParallel = !linker.empty();
+	// Shared by every file being compiled, so that dumps from
+	// different threads never interleave.
+	static std::mutex printMutex;
+	auto DumpIR = [](llvm::Module & module) {
+	    std::lock_guard<std::mutex> lock(printMutex);
+	    module.print(llvm::errs(), nullptr);
+	};
+	auto CompilePartition = [&](const size_t index) {
+	    auto & partition = partitions[index];
+	    try {
+		partition.state = llvm::make_unique<LLVMState>();
+		auto & state = *partition.state;
+		const size_t begin = index * topLevel.size() / partitionCount;
+		const size_t end = (index + 1) * topLevel.size() / partitionCount;
+		// Objects are cached when the partitions are emitted
+		// separately, optimized IR otherwise.
+		std::string cacheKey;
+		if (incremental && begin < end) {
+		    if (auto function = llvm::dyn_cast<ast::Function>(topLevel[begin].get())) {
+			cacheKey = cache->GetKey(
+			    function->GetFingerprint(), options,
+			    emitInParallel ? "function.o" : "function.bc");
+		    }
+		}
+		if (!cacheKey.empty() && emitInParallel &&
+		    cache->LookupBuffer(cacheKey, partition.object)) {
+		    return;
+		}
+		partition.targetMachine = CreateTargetMachine(targetTriple, options, run);
+		if (!cacheKey.empty() && !emitInParallel &&
+		    LookupModule(*cache, cacheKey, state)) {
+		    return;
+		}
+		// Set up front, since code generation sizes arrays with the
+		// target's data layout.
+		state.modRef->setTargetTriple(targetTriple);
+		state.modRef->setDataLayout(partition.targetMachine->createDataLayout());
+		{
+		    PhaseTimer timer(report, TimeReport::Phase::CodeGen);
+		    for (size_t i = begin; i < end; ++i) {
+			topLevel[i]->CodeGen(state);
+		    }
+		}
+		if (report) {
+		    report->AddCount(&TimeReport::Counts::irInstructions,
+				     TimeReport::CountInstructions(*state.modRef));
+		}
+		if (driverOptions.printIR == DriverOptions::PrintIR::BeforeOpt) {
+		    DumpIR(*state.modRef);
+		}
+		{
+		    PhaseTimer timer(report, TimeReport::Phase::Optimize);
+		    Optimize(*state.modRef, *partition.targetMachine, options);
+		}
+		if (report) {
+		    report->AddCount(&TimeReport::Counts::optimizedIRInstructions,
+				     TimeReport::CountInstructions(*state.modRef));
+		}
+		if (driverOptions.printIR == DriverOptions::PrintIR::AfterOpt) {
+		    DumpIR(*state.modRef);
+		}
+		if (emitInParallel) {
+		    PhaseTimer timer(report, TimeReport::Phase::Emit);
+		    llvm::raw_svector_ostream os(partition.object);
+		    if (!EmitMachineCode(*state.modRef, *partition.targetMachine, os,
+					 llvm::TargetMachine::CGFT_ObjectFile)) {
+			partition.error = "TheTargetMachine can't emit a file of this type";
+			return;
+		    }
+		}
+		if (!cacheKey.empty()) {
+		    if (emitInParallel) {
+			cache->StoreBuffer(cacheKey, llvm::StringRef(partition.object.data(),
+								     partition.object.size()));
+		    } else {
+			StoreModule(*cache, cacheKey, *state.modRef);
+		    }
+		}
+	    } catch (const std::exception & ex) {
+		partition.error = ex.what();
+	    }
+	};
+	if (threadCount == 1) {
+	    for (size_t i = 0; i < partitionCount; ++i) {
+		CompilePartition(i);
+	    }
+	} else {
+	    llvm::ThreadPool pool(static_cast<unsigned>(threadCount));
+	    for (size_t i = 0; i < partitionCount; ++i) {
+		pool.async(CompilePartition, i);
+	    }
+	    pool.wait();
+	}
+	for (auto & partition : partitions) {
+	    if (!partition.error.empty()) {
+		throw std::runtime_error(partition.error);
+	    }
+	}
+	if (emitInParallel) {
+	    PhaseTimer timer(report, TimeReport::Phase::Link);
+	    LinkObjects(linker, partitions, outputName);
+	    return EXIT_SUCCESS;
+	}
+	{
+	    PhaseTimer timer(report, TimeReport::Phase::Link);
+	    MergePartitions(partitions);
+	}
+	auto & state = *partitions.front().state;
+	auto & targetMachine = partitions.front().targetMachine;
+	if (partitionCount > 1) {
+	    PhaseTimer timer(report, TimeReport::Phase::Optimize);
+	    OptimizeLinked(*state.modRef, *targetMachine, options);
+	}
+	if (run) {
+	    return RunCode(std::move(state.modRef), std::move(targetMachine),
+			   driverOptions.entry, compileStart, report);
+	}
+	PhaseTimer timer(report, TimeReport::Phase::Emit);
+	EmitOutput(*state.modRef, *targetMachine, outputName, driverOptions.action);
+	return EXIT_SUCCESS;
+    }
+
+    // Each file gets its own Parser, Arena and LLVMState, so files share
+    // nothing but the immutable Type instances and can be compiled on
+    // any thread. Errors are returned instead of printed.
+    static int CompileFile(const std::string & fname, const CompileOptions & options,
+			   const DriverOptions & driverOptions, CompilationCache * cache,
+			   TimeReport * report, std::string & diagnostics) {
+	try {
+	    std::unique_ptr<SourceFile> sourceFile;
+	    {
+		PhaseTimer timer(report, TimeReport::Phase::Read);
+		sourceFile.reset(new SourceFile(fname));
+	    }
+	    llvm::StringRef source(sourceFile->GetData(), sourceFile->GetSize());
+	    const auto outputName = GetOutputName(fname, driverOptions);
+	    // Only outputs that end up in a file can be cached. Printing
+	    // IR is a request to see the compiler run.
+	    const bool cacheable = cache &&
+		driverOptions.action != DriverOptions::Action::Run &&
+		driverOptions.printIR == DriverOptions::PrintIR::None &&
+		outputName != "-";
+	    std::string cacheKey;
+	    if (cacheable) {
+		cacheKey = cache->GetKey(
+		    source, options, GetOutputExtension(driverOptions.action));
+		if (cache->Lookup(cacheKey, outputName)) {
+		    return EXIT_SUCCESS;
+		}
+	    }
+	    if (report) {
+		report->AddCount(&TimeReport::Counts::files, 1);
+		report->AddCount(&TimeReport::Counts::lines,
+				 std::count(source.begin(), source.end(), '\n'));
+		report->AddCount(&TimeReport::Counts::bytes, source.size());
+		// The parser pulls tokens from its lexer as it needs
+		// them, so lexing on its own is measured in a separate
+		// pass over the file.
+		PhaseTimer timer(report, TimeReport::Phase::Lex);
+		Lexer lexer(source.begin(), source.end());
+		uint64_t tokens = 0;
+		while (lexer.Next() != Token::ENDOFFILE) {
+		    ++tokens;
+		}
+		report->AddCount(&TimeReport::Counts::tokens, tokens);
+	    }
+	    ast::Arena arena;
+	    Parser parser(arena);
+	    ast::NodeRef root(nullptr);
+	    {
+		PhaseTimer timer(report, TimeReport::Phase::Parse);
+		root = parser.Parse(*sourceFile);
+	    }
+	    {
+		PhaseTimer timer(report, TimeReport::Phase::Fold);
+		root->Fold(arena);
+	    }
+	    if (report) {
+		report->AddCount(&TimeReport::Counts::astNodes, arena.GetNodeCount());
+	    }
+	    const int result = GenerateCode(root, fname, options, driverOptions, cache, report);
+	    if (cacheable && result == EXIT_SUCCESS) {
+		cache->Store(cacheKey, outputName);
+	    }
+	    return result;
+	} catch (const std::exception & ex) {
+	    diagnostics = std::string(ex.what()) + " for file " + fname;
+	    return EXIT_FAILURE;
+	}
+    }
+
+    static void PrintCacheStats(const CompilationCache & cache) {
+	const auto & run = cache.GetStats();
+	const auto totals = cache.GetTotalStats();
+	std::cerr << "cache: " << run.hits << " hits, " << run.misses << " misses, "
+		  << run.evictions << " evictions\n"
+		  << "cache totals: " << totals.hits << " hits, " << totals.misses
+		  << " misses, " << totals.evictions << " evictions\n"
+		  << "cache size: " << cache.GetSize() << " of " << cache.GetMaxSize()
+		  << " bytes" << std::endl;
+    }
+
+    int CompileFiles(const std::vector<std::string> & fnames, const CompileOptions & options,
+		     const DriverOptions & driverOptions) {
+	std::unique_ptr<CompilationCache> cache;
+	if (!driverOptions.cacheDir.empty()) {
+	    try {
+		cache.reset(new CompilationCache(driverOptions.cacheDir,
+						 driverOptions.cacheSize,
+						 driverOptions.compilerPath));
+	    } catch (const std::exception & ex) {
+		std::cerr << ex.what() << std::endl;
+		return EXIT_FAILURE;
+	    }
+	}
+	std::unique_ptr<TimeReport> report;
+	if (driverOptions.timeReport) {
+	    report.reset(new TimeReport());
+	}
+	std::vector<std::string> diagnostics(fnames.size());
+	std::vector<int> results(fnames.size(), EXIT_FAILURE);
+	if (fnames.size() == 1) {
+	    results[0] = CompileFile(fnames[0], options, driverOptions, cache.get(),
+				     report.get(), diagnostics[0]);
+	} else if (fnames.size() > 1) {
+	    unsigned jobs = driverOptions.jobs;
+	    if (jobs == 0) {
+		jobs = std::max(1u, std::thread::hardware_concurrency());
+	    }
+	    // The threads are spent on whole files, so each file is
+	    // lowered as a single partition.
+	    DriverOptions fileOptions = driverOptions;
+	    fileOptions.jobs = 1;
+	    auto CompileJob = [&](const size_t index) {
+		results[index] = CompileFile(fnames[index], options, fileOptions,
+					     cache.get(), report.get(), diagnostics[index]);
+	    };
+	    const size_t threadCount = std::min<size_t>(jobs, fnames.size());
+	    llvm::ThreadPool pool(static_cast<unsigned>(threadCount));
+	    for (size_t i = 0; i < fnames.size(); ++i) {
+		pool.async(CompileJob, i);
+	    }
+	    pool.wait();
+	}
+	int result = EXIT_SUCCESS;
+	for (size_t i = 0; i < fnames.size(); ++i) {
+	    if (!diagnostics[i].empty()) {
+		std::cerr << diagnostics[i] << std::endl;
+	    }
+	    if (results[i] != EXIT_SUCCESS) {
+		result = results[i];
+	    }
+	}
+	if (cache) {
+	    cache->Finish();
+	    if (driverOptions.printCacheStats) {
+		PrintCacheStats(*cache);
+	    }
+	}
+	if (report) {
+	    report->Print(llvm::errs());
+	    if (!driverOptions.timeReportFile.empty()) {
+		std::error_code EC;
+		llvm::raw_fd_ostream os(driverOptions.timeReportFile, EC, llvm::sys::fs::F_Text);
+		if (EC) {
+		    std::cerr << "Could not open file: " << EC.message() << std::endl;
+		    return EXIT_FAILURE;
+		}
+		report->PrintJSON(os);
+	    }
+	}
+	return result;
+    }
+}
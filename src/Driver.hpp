@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ast.hpp"
+#include "Backend.hpp"
+
+namespace coralc {
+    struct DriverOptions {
+	enum class Action {
+	    EmitObject,
+	    EmitAssembly,
+	    EmitLLVM,
+	    EmitBitcode,
+	    Run
+	};
+	enum class PrintIR {
+	    None,
+	    BeforeOpt,
+	    AfterOpt
+	};
+	Action action = Action::EmitObject;
+	PrintIR printIR = PrintIR::None;
+	std::string entry = "main";
+	// Empty means derive the name from the input file.
+	std::string outputName;
+	// Number of threads used for code generation. With several
+	// input files, this many files are compiled at once. With one,
+	// its top level functions are split into at most this many
+	// partitions, each lowered and optimized in its own LLVMContext.
+	// 0 means one thread per hardware core.
+	unsigned jobs = 1;
+	// Where compiled outputs are cached across runs. Empty disables
+	// the cache.
+	std::string cacheDir;
+	uint64_t cacheSize = 512 * 1024 * 1024;
+	// The running coralc executable, which cached outputs are keyed
+	// by.
+	std::string compilerPath;
+	bool printCacheStats = false;
+	// Cache functions one at a time, rather than only whole files.
+	bool incremental = false;
+	// Print where compile time went to stderr, and as JSON to
+	// timeReportFile when it isn't empty.
+	bool timeReport = false;
+	std::string timeReportFile;
+    };
+
+    class CompilationCache;
+    class TimeReport;
+
+    // With driverOptions.incremental set, each function's optimized IR
+    // or object is looked up in the cache by the function's
+    // fingerprint, so that only functions that changed since an
+    // earlier compile are lowered and optimized.
+    int GenerateCode(ast::NodeRef & root, const std::string & fname,
+		     const CompileOptions &, const DriverOptions &,
+		     CompilationCache * cache = nullptr, TimeReport * report = nullptr);
+
+    // Parses and compiles every file, each into its own output. With
+    // more than one file, the files are compiled concurrently, up to
+    // driverOptions.jobs at a time. Diagnostics are printed after all
+    // jobs finish, in the order the files were given. Outputs found in
+    // the cache are copied instead of compiled.
+    int CompileFiles(const std::vector<std::string> & fnames, const CompileOptions &,
+		     const DriverOptions &);
+}
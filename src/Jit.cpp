@@ -0,0 +1,30 @@
+#include "Jit.hpp"
+
+#include "llvm/ExecutionEngine/OrcMCJITReplacement.h"
+#include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include <stdexcept>
+
+namespace coralc {
+    Jit::Jit(std::unique_ptr<llvm::Module> module,
+	     std::unique_ptr<llvm::TargetMachine> targetMachine) {
+	std::string error;
+	llvm::EngineBuilder builder(std::move(module));
+	builder.setErrorStr(&error)
+	    .setEngineKind(llvm::EngineKind::JIT)
+	    .setMCJITMemoryManager(llvm::make_unique<llvm::SectionMemoryManager>())
+	    .setUseOrcMCJITReplacement(true);
+	m_engine.reset(builder.create(targetMachine.release()));
+	if (!m_engine) {
+	    throw std::runtime_error("Failed to create JIT: " + error);
+	}
+	m_engine->finalizeObject();
+    }
+
+    void * Jit::GetFunctionAddress(const std::string & name) {
+	auto address = m_engine->getFunctionAddress(name);
+	if (!address) {
+	    throw std::runtime_error("JIT failed to resolve function " + name);
+	}
+	return reinterpret_cast<void *>(address);
+    }
+}
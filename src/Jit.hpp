@@ -0,0 +1,19 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include "llvm/ExecutionEngine/ExecutionEngine.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Target/TargetMachine.h"
+
+namespace coralc {
+    // Compiles a module in-process with the ORC backed MCJIT
+    // replacement, so that its functions can be called directly
+    // without going through an object file and a linker.
+    class Jit {
+	std::unique_ptr<llvm::ExecutionEngine> m_engine;
+    public:
+	Jit(std::unique_ptr<llvm::Module>, std::unique_ptr<llvm::TargetMachine>);
+	void * GetFunctionAddress(const std::string &);
+    };
+}
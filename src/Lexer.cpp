@@ -0,0 +1,170 @@
+#include "Lexer.hpp"
+
+#include "llvm/ADT/StringSwitch.h"
+
+namespace coralc {
+    static bool IsDigit(const char c) {
+	return c >= '0' && c <= '9';
+    }
+
+    static bool IsIdentStart(const char c) {
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+    }
+
+    static bool IsIdentBody(const char c) {
+	return IsIdentStart(c) || IsDigit(c);
+    }
+
+    void Lexer::SkipWhitespaceAndComments() {
+	while (m_pos != m_end) {
+	    switch (*m_pos) {
+	    case '\n':
+		++m_line;
+		++m_pos;
+		break;
+
+	    case ' ':
+	    case '\t':
+	    case '\r':
+		++m_pos;
+		break;
+
+	    case '/':
+		if (m_end - m_pos > 1 && m_pos[1] == '/') {
+		    while (m_pos != m_end && *m_pos != '\n') {
+			++m_pos;
+		    }
+		    break;
+		}
+		return;
+
+	    default:
+		return;
+	    }
+	}
+    }
+
+    Token Lexer::LexNumber(const char * start) {
+	while (m_pos != m_end && IsDigit(*m_pos)) {
+	    ++m_pos;
+	}
+	// A '.' only continues the literal when a digit follows, so that
+	// ranges like 0..10 lex as INTEGER RANGE INTEGER.
+	if (m_end - m_pos > 1 && m_pos[0] == '.' && IsDigit(m_pos[1])) {
+	    ++m_pos;
+	    while (m_pos != m_end && IsDigit(*m_pos)) {
+		++m_pos;
+	    }
+	    m_text = llvm::StringRef(start, m_pos - start);
+	    return Token::FLOAT;
+	}
+	m_text = llvm::StringRef(start, m_pos - start);
+	return Token::INTEGER;
+    }
+
+    Token Lexer::LexIdentOrKeyword(const char * start) {
+	while (m_pos != m_end && IsIdentBody(*m_pos)) {
+	    ++m_pos;
+	}
+	m_text = llvm::StringRef(start, m_pos - start);
+	return llvm::StringSwitch<Token>(m_text)
+	    .Case("for", Token::FOR)
+	    .Case("in", Token::IN)
+	    .Case("if", Token::IF)
+	    .Case("then", Token::THEN)
+	    .Case("else", Token::ELSE)
+	    .Case("elseif", Token::ELSEIF)
+	    .Case("do", Token::DO)
+	    .Case("end", Token::END)
+	    .Case("var", Token::VAR)
+	    .Case("reverse", Token::REVERSE)
+	    .Case("def", Token::DEF)
+	    .Case("return", Token::RETURN)
+	    .Case("mut", Token::MUT)
+	    .Case("and", Token::AND)
+	    .Case("or", Token::OR)
+	    .Case("module", Token::MODULE)
+	    .Cases("true", "false", Token::BOOLEAN)
+	    .Default(Token::IDENT);
+    }
+
+    Token Lexer::LexString(const char * start) {
+	while (m_pos != m_end && *m_pos != '"') {
+	    if (*m_pos == '\n') {
+		++m_line;
+	    }
+	    ++m_pos;
+	}
+	if (m_pos == m_end) {
+	    m_text = llvm::StringRef(start, m_pos - start);
+	    return Token::INVALID;
+	}
+	++m_pos;
+	m_text = llvm::StringRef(start, m_pos - start);
+	return Token::STRING;
+    }
+
+    Token Lexer::Next() {
+	this->SkipWhitespaceAndComments();
+	if (m_pos == m_end) {
+	    m_text = llvm::StringRef();
+	    return Token::ENDOFFILE;
+	}
+	const char * start = m_pos;
+	const char c = *m_pos++;
+	if (IsDigit(c)) {
+	    return this->LexNumber(start);
+	}
+	if (IsIdentStart(c)) {
+	    return this->LexIdentOrKeyword(start);
+	}
+	if (c == '"') {
+	    return this->LexString(start);
+	}
+	auto Punct = [this, start](const Token token) {
+	    m_text = llvm::StringRef(start, m_pos - start);
+	    return token;
+	};
+	switch (c) {
+	case ';': return Punct(Token::EXPREND);
+	case ',': return Punct(Token::COMMA);
+	case ':': return Punct(Token::COLON);
+	case '{': return Punct(Token::LBRACE);
+	case '}': return Punct(Token::RBRACE);
+	case '[': return Punct(Token::LBRACKET);
+	case ']': return Punct(Token::RBRACKET);
+	case '+': return Punct(Token::ADD);
+	case '-': return Punct(Token::SUBTRACT);
+	case '*': return Punct(Token::MULTIPLY);
+	case '/': return Punct(Token::DIVIDE);
+	case '%': return Punct(Token::MODULUS);
+	case '#': return Punct(Token::HASH);
+	case '(': return Punct(Token::LPRN);
+	case ')': return Punct(Token::RPRN);
+
+	case '.':
+	    if (m_pos != m_end && *m_pos == '.') {
+		++m_pos;
+		return Punct(Token::RANGE);
+	    }
+	    return Punct(Token::INVALID);
+
+	case '=':
+	    if (m_pos != m_end && *m_pos == '=') {
+		++m_pos;
+		return Punct(Token::EQUALITY);
+	    }
+	    return Punct(Token::ASSIGN);
+
+	case '!':
+	    if (m_pos != m_end && *m_pos == '=') {
+		++m_pos;
+		return Punct(Token::INEQUALITY);
+	    }
+	    return Punct(Token::INVALID);
+
+	default:
+	    return Punct(Token::INVALID);
+	}
+    }
+}
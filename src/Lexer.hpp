@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include "llvm/ADT/StringRef.h"
+
+namespace coralc {
+    enum class Token {
+	ENDOFFILE,
+	FOR,
+	IN,
+	IF,
+	THEN,
+	ELSE,
+	ELSEIF,
+	DO,
+	RANGE,
+	EXPREND,
+	END,
+	VAR,
+	REVERSE,
+	DEF,
+	ASSIGN,
+	COMMA,
+	COLON,
+	LBRACE,
+	RBRACE,
+	LBRACKET,
+	RBRACKET,
+	ADD,
+	SUBTRACT,
+	MULTIPLY,
+	DIVIDE,
+	MODULUS,
+	EQUALITY,
+	INEQUALITY,
+	BOOLEAN,
+	RETURN,
+	MUT,
+	HASH,
+	LPRN,
+	RPRN,
+	AND,
+	OR,
+	STRING,
+	FLOAT,
+	INTEGER,
+	MODULE,
+	IDENT,
+	// A character or unterminated literal that starts no valid token.
+	INVALID
+    };
+
+    // Hand-written scanner over a buffer that it never writes to. All
+    // position state lives in the object, so each Parser owns its own
+    // Lexer and several files can be lexed at once.
+    class Lexer {
+	const char * m_pos;
+	const char * m_end;
+	llvm::StringRef m_text;
+	size_t m_line;
+	void SkipWhitespaceAndComments();
+	Token LexNumber(const char * start);
+	Token LexIdentOrKeyword(const char * start);
+	Token LexString(const char * start);
+    public:
+	Lexer() : Lexer(nullptr, nullptr) {}
+	Lexer(const char * begin, const char * end) :
+	    m_pos(begin), m_end(end), m_line(1) {}
+	Token Next();
+	// The spelling of the token most recently returned by Next. It
+	// points into the source buffer.
+	llvm::StringRef GetText() const {
+	    return m_text;
+	}
+	size_t GetLine() const {
+	    return m_line;
+	}
+    };
+}
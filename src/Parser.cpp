@@ -1,21 +1,12 @@
 #include "Parser.hpp"
 
-extern "C" {
-    int yylex();
-    
-    char * yytext;
-    
-    void * yy_scan_string(const char *);
-
-    void yy_free_current_buffer(void);
-
-    size_t get_linum(void);
-}
+#include <cstdlib>
+#include "llvm/ADT/StringSwitch.h"
 
 namespace coralc {
     void Parser::Error(const std::string & err) {
 	std::string errMsg = "Error [line " +
-	    std::to_string(get_linum()) + "]:\n\t" + err + "\n";
+	    std::to_string(m_lexer.GetLine()) + "]:\n\t" + err + "\n";
 	throw std::runtime_error(errMsg);
     }
 
@@ -26,196 +17,387 @@ namespace coralc {
 	}
     }
     
-    Parser::Parser() : m_currentToken({Token::ENDOFFILE, {}}) {}
-
-    std::pair<ast::NodeRef, std::string>
-    Parser::MakeExprSubTree(std::deque<Parser::TokenInfo> && exprQueueRPN) {
-	// This function takes an RPN formatted expression and uses
-	// it to construct a syntax subtree representing that expression.
-	struct Value {
-	    ast::NodeRef node;
-	    std::string type;
-	};
-	auto OperandTypeError = [this](const std::string & t1,
-				   const std::string & t2) {
-				    this->Error("Operand type mismatch: " + t1 + " and " + t2);
-				};
-	std::stack<Value> valueStack;
-	auto GetValueStackTopTwo = [&valueStack, OperandTypeError]()
-	    -> std::pair<Value, Value> {
-	    auto rhs = std::move(valueStack.top());
-	    valueStack.pop();
-	    auto lhs = std::move(valueStack.top());
-	    valueStack.pop();
-	    if (lhs.type != rhs.type) {
-		OperandTypeError(lhs.type, rhs.type);
-	    }
-	    return {std::move(lhs), std::move(rhs)};
-	};
-	std::string exprType = "";
-	while (!exprQueueRPN.empty()) {
-	    auto & curr = exprQueueRPN.front();
-	    switch (curr.id) {
-	    case Token::BOOLEAN:
-		valueStack.push({
-			ast::NodeRef(new ast::Boolean(curr.text == "true")),
-			"bool"
-		    });
+    Parser::Parser(ast::Arena & arena) :
+	m_arena(arena), m_fingerprint(nullptr), m_currentToken({Token::ENDOFFILE, 0}) {}
+
+    std::string Parser::GetText(const Symbol symbol) const {
+	return m_symbols.GetText(symbol).str();
+    }
+
+    llvm::StringRef Parser::GetName(const Symbol symbol) {
+	return m_arena.CopyString(m_symbols.GetText(symbol));
+    }
+
+    int Parser::ParseInteger(const Symbol symbol) {
+	int value = 0;
+	if (m_symbols.GetText(symbol).getAsInteger(10, value)) {
+	    Error("Integer literal " + GetText(symbol) + " is out of range");
+	}
+	return value;
+    }
+
+    float Parser::ParseFloat(const Symbol symbol) const {
+	// Interned text is NUL terminated.
+	return std::strtof(m_symbols.GetText(symbol).data(), nullptr);
+    }
+
+    // Returns -1 for tokens that aren't binary operators, which ends
+    // the operator loop in ParseBinaryExpr. All operators are left
+    // associative.
+    int Parser::BinaryPrecedence(const Token token) {
+	switch (token) {
+	case Token::MULTIPLY:
+	case Token::DIVIDE:
+	case Token::MODULUS: return 4;
+	case Token::ADD:
+	case Token::SUBTRACT: return 3;
+	case Token::EQUALITY:
+	case Token::INEQUALITY: return 2;
+	case Token::AND:
+	case Token::OR: return 1;
+	default: return -1;
+	}
+    }
+
+    Parser::ExprInfo Parser::ParseExpr(const Token exprend) {
+	if (m_currentToken.id == exprend) {
+	    return {nullptr, &Type::Void};
+	}
+	auto expr = this->ParseBinaryExpr(exprend, 1);
+	if (m_currentToken.id != exprend) {
+	    switch (m_currentToken.id) {
+	    case Token::RPRN:
+		Error("Mis-matched parentheses");
 		break;
-		
-	    case Token::INTEGER:
-		valueStack.push({
-			ast::NodeRef(new ast::Integer(std::stoi(curr.text))),
-			"int"
-		    });
+
+	    case Token::ASSIGN:
+		Error("Assignment not allowed in rhs expression");
 		break;
-		
-	    case Token::FLOAT:
-		valueStack.push({
-			ast::NodeRef(new ast::Float(std::stof(curr.text))),
-			"float"
-		    });
+
+	    case Token::END:
+	    case Token::ENDOFFILE:
+		Error("Expression missing terminator");
 		break;
-		
-	    case Token::IDENT:
-		if (m_varTable.find(curr.text) == m_varTable.end()) {
-		    Error("Attempt to reference nonexistent variable " + curr.text);
-		}
-		valueStack.push({
-			ast::NodeRef(new ast::Ident(curr.text)),
-			m_varTable[curr.text].type
-		    });
+
+	    default:
+		Error("Unexpected token " + GetText(m_currentToken.text) + " in expression");
 		break;
+	    }
+	}
+	return expr;
+    }
 
-	    case Token::AND: {
-		auto operands = GetValueStackTopTwo();
-		if (operands.first.type != "bool" || operands.second.type != "bool") {
-		    Error("Logical and operands must be booleans");
-		}
-		auto andOpRef =
-		    std::make_unique<ast::LogicalAndOp>(std::move(operands.first.node),
-							std::move(operands.second.node));
-	        valueStack.push({ast::NodeRef(andOpRef.release()), "bool"});
-	    } break;
-
-	    case Token::OR: {
-		auto operands = GetValueStackTopTwo();
-		if (operands.first.type != "bool" || operands.second.type != "bool") {
-		    Error("Logical and operands must be booleans");
-		}
-		auto orOpRef =
-		    std::make_unique<ast::LogicalOrOp>(std::move(operands.first.node),
-						       std::move(operands.second.node));
-	        valueStack.push({ast::NodeRef(orOpRef.release()), "bool"});
-	    } break;
-		
-	    case Token::INEQUALITY: {
-		auto operands = GetValueStackTopTwo();
-		auto inequalityOpRef =
-		    std::make_unique<ast::InequalityOp>(operands.first.type,
-							std::move(operands.first.node),
-							std::move(operands.second.node));
-		valueStack.push({ast::NodeRef(inequalityOpRef.release()), "bool"});
-	    } break;
-		
-	    case Token::EQUALITY: {
-		auto operands = GetValueStackTopTwo();
-		auto equalityOpRef =
-		    std::make_unique<ast::EqualityOp>(operands.first.type,
-						      std::move(operands.first.node),
-						      std::move(operands.second.node));
-		valueStack.push({ast::NodeRef(equalityOpRef.release()), "bool"});
-	    } break;
-
-	    case Token::ADD: {
-		auto operands = GetValueStackTopTwo();
-		if (operands.first.type != "int" && operands.first.type != "float") {
-		    Error("The \'+\' arithmetic operator expects int or float operands");
-		}
-		auto addOpRef =
-		    std::make_unique<ast::AddOp>(operands.first.type,
-						 std::move(operands.first.node),
-						 std::move(operands.second.node));
-		valueStack.push({ast::NodeRef(addOpRef.release()), operands.first.type});
-	    } break;
-
-	    case Token::SUBTRACT: {
-		auto operands = GetValueStackTopTwo();
-		if (operands.first.type != "int" && operands.first.type != "float") {
-		    Error("The \'-\' arithmetic operator expects int or float operands");
-		}
-		auto subOpRef =
-		    std::make_unique<ast::SubOp>(operands.first.type,
-						 std::move(operands.first.node),
-						 std::move(operands.second.node));
-		valueStack.push({ast::NodeRef(subOpRef.release()), operands.first.type});
-	    } break;
-
-	    case Token::MULTIPLY: {
-		auto operands = GetValueStackTopTwo();
-		if (operands.first.type != "int" && operands.first.type != "float") {
-		    Error("The \'*\' arithmetic operator expects int or float operands");
-		}
-		auto multOpRef =
-		    std::make_unique<ast::MultOp>(operands.first.type,
-						  std::move(operands.first.node),
-						  std::move(operands.second.node));
-		valueStack.push({ast::NodeRef(multOpRef.release()), operands.first.type});
-	    } break;
-
-	    case Token::DIVIDE: {
-		auto operands = GetValueStackTopTwo();
-		if (operands.first.type != "int" && operands.first.type != "float") {
-		    Error("The \'/\' arithmetic operator expects int or float operands");
-		}
-		auto divOpRef =
-		    std::make_unique<ast::DivOp>(operands.first.type,
-						 std::move(operands.first.node),
-						 std::move(operands.second.node));
-		valueStack.push({ast::NodeRef(divOpRef.release()), operands.first.type});
-	    } break;
-
-	    case Token::MODULUS: {
-		auto operands = GetValueStackTopTwo();
-		if (operands.first.type != "int" && operands.first.type != "float") {
-		    Error("The \'%\' arithmetic operator expects int or float operands");
-		}
-		auto modOpRef =
-		    std::make_unique<ast::ModOp>(operands.first.type,
-						 std::move(operands.first.node),
-						 std::move(operands.second.node));
-		valueStack.push({ast::NodeRef(modOpRef.release()), operands.first.type});
-	    } break;
+    Parser::ExprInfo Parser::ParseBinaryExpr(const Token exprend, const int minPrecedence) {
+	auto lhs = this->ParsePrimaryExpr(exprend);
+	while (true) {
+	    const Token op = m_currentToken.id;
+	    const int precedence = BinaryPrecedence(op);
+	    if (precedence < minPrecedence) {
+		return lhs;
 	    }
-	    exprQueueRPN.pop_front();
+	    this->NextToken();
+	    auto rhs = this->ParseBinaryExpr(exprend, precedence + 1);
+	    lhs = this->MakeBinOp(op, std::move(lhs), std::move(rhs));
 	}
-	if (valueStack.size() == 0) {
-	    return {nullptr, "void"};
-	} else if (valueStack.size() != 1) {
-	    throw std::runtime_error("__Internal error: failed to build expression tree");
+    }
+
+    Parser::ExprInfo Parser::ParsePrimaryExpr(const Token exprend) {
+	const auto curr = m_currentToken;
+	switch (curr.id) {
+	case Token::BOOLEAN:
+	    this->NextToken();
+	    return {m_arena.Make<ast::Boolean>(m_symbols.GetText(curr.text) == "true"),
+		    &Type::Bool};
+
+	case Token::INTEGER:
+	    this->NextToken();
+	    return {m_arena.Make<ast::Integer>(this->ParseInteger(curr.text)), &Type::Int};
+
+	case Token::FLOAT:
+	    this->NextToken();
+	    return {m_arena.Make<ast::Float>(this->ParseFloat(curr.text)), &Type::Float};
+
+	case Token::IDENT: {
+	    this->NextToken();
+	    if (m_currentToken.id == Token::LPRN) {
+		return this->ParseCall(curr, exprend);
+	    }
+	    if (m_currentToken.id == Token::LBRACKET) {
+		return this->ParseIndex(curr, exprend);
+	    }
+	    auto var = m_varTable.find(curr.text);
+	    if (var == m_varTable.end()) {
+		Error("Attempt to reference nonexistent variable " + GetText(curr.text));
+	    }
+	    if (var->second.type->IsArray()) {
+		Error("Array " + GetText(curr.text) + " can only be indexed");
+	    }
+	    return {m_arena.Make<ast::Ident>(GetName(curr.text)), var->second.type};
+	}
+
+	case Token::LPRN: {
+	    this->NextToken();
+	    auto inner = this->ParseBinaryExpr(exprend, 1);
+	    if (m_currentToken.id != Token::RPRN) {
+		Error("Mis-matched parentheses");
+	    }
+	    this->NextToken();
+	    return inner;
+	}
+
+	case Token::RPRN:
+	    Error("Mis-matched parentheses");
+	    break;
+
+	case Token::ASSIGN:
+	    Error("Assignment not allowed in rhs expression");
+	    break;
+
+	case Token::END:
+	case Token::ENDOFFILE:
+	    Error("Expression missing terminator");
+	    break;
+
+	default:
+	    if (curr.id == exprend) {
+		Error("Expected operand");
+	    }
+	    Error("Unexpected token " + GetText(curr.text) + " in expression");
+	    break;
+	}
+	return {nullptr, &Type::Void};
+    }
+
+    Parser::ExprInfo Parser::MakeBinOp(const Token op, ExprInfo lhs, ExprInfo rhs) {
+	if (lhs.type != rhs.type) {
+	    Error("Operand type mismatch: " + lhs.type->GetName() +
+		  " and " + rhs.type->GetName());
+	}
+	auto type = lhs.type;
+	if (type == &Type::Void) {
+	    Error("Operands of binary operators can't be void");
+	}
+	auto ExpectArithmetic = [this, type](const char * opName) {
+	    if (!type->IsArithmetic()) {
+		this->Error(std::string("The \'") + opName +
+			    "\' arithmetic operator expects int or float operands");
+	    }
+	};
+	switch (op) {
+	case Token::AND:
+	    if (type != &Type::Bool) {
+		Error("Logical and operands must be booleans");
+	    }
+	    return {m_arena.Make<ast::LogicalAndOp>(std::move(lhs.node), std::move(rhs.node)),
+		    &Type::Bool};
+
+	case Token::OR:
+	    if (type != &Type::Bool) {
+		Error("Logical or operands must be booleans");
+	    }
+	    return {m_arena.Make<ast::LogicalOrOp>(std::move(lhs.node), std::move(rhs.node)),
+		    &Type::Bool};
+
+	case Token::INEQUALITY:
+	    return {m_arena.Make<ast::InequalityOp>(type, std::move(lhs.node),
+						    std::move(rhs.node)),
+		    &Type::Bool};
+
+	case Token::EQUALITY:
+	    return {m_arena.Make<ast::EqualityOp>(type, std::move(lhs.node),
+						  std::move(rhs.node)),
+		    &Type::Bool};
+
+	case Token::ADD:
+	    ExpectArithmetic("+");
+	    return {m_arena.Make<ast::AddOp>(type, std::move(lhs.node), std::move(rhs.node)),
+		    type};
+
+	case Token::SUBTRACT:
+	    ExpectArithmetic("-");
+	    return {m_arena.Make<ast::SubOp>(type, std::move(lhs.node), std::move(rhs.node)),
+		    type};
+
+	case Token::MULTIPLY:
+	    ExpectArithmetic("*");
+	    return {m_arena.Make<ast::MultOp>(type, std::move(lhs.node), std::move(rhs.node)),
+		    type};
+
+	case Token::DIVIDE:
+	    ExpectArithmetic("/");
+	    return {m_arena.Make<ast::DivOp>(type, std::move(lhs.node), std::move(rhs.node)),
+		    type};
+
+	case Token::MODULUS:
+	    ExpectArithmetic("%");
+	    return {m_arena.Make<ast::ModOp>(type, std::move(lhs.node), std::move(rhs.node)),
+		    type};
+
+	default:
+	    throw std::runtime_error("__Internal error: unexpected binary operator");
+	}
+    }
+
+    // The return type of a call is that of its callee, so return types
+    // are deduced across calls.
+    Parser::ExprInfo Parser::ParseCall(const TokenInfo & callee, const Token exprend) {
+	const std::string name = GetText(callee.text);
+	auto found = m_functions.find(callee.text);
+	if (found == m_functions.end()) {
+	    Error("Call to undefined function " + name +
+		  ", functions must be defined before they are called");
+	}
+	auto & signature = found->second;
+	const Type * returnType = signature.returnType;
+	if (callee.text == m_currentFunction.symbol) {
+	    returnType = m_currentFunction.returnType;
+	    if (!returnType) {
+		Error("The return type of " + name +
+		      " must be deduced from a return before it can call itself");
+	    }
+	    m_currentFunction.callsItself = true;
+	} else {
+	    signature.node->SetCalled();
+	}
+	const auto & paramTypes = signature.paramTypes;
+	std::vector<ast::NodeRef> args;
+	this->NextToken();
+	while (m_currentToken.id != Token::RPRN) {
+	    auto arg = this->ParseBinaryExpr(exprend, 1);
+	    if (args.size() == paramTypes.size()) {
+		Error("Too many arguments in call to " + name);
+	    }
+	    if (arg.type != paramTypes[args.size()]) {
+		Error("Argument " + std::to_string(args.size() + 1) + " of " + name +
+		      " is " + arg.type->GetName() + ", expected " +
+		      paramTypes[args.size()]->GetName());
+	    }
+	    args.push_back(std::move(arg.node));
+	    if (m_currentToken.id == Token::COMMA) {
+		this->NextToken();
+	    } else if (m_currentToken.id != Token::RPRN) {
+		Error("Expected , or ) in call to " + name);
+	    }
+	}
+	if (args.size() != paramTypes.size()) {
+	    Error("Too few arguments in call to " + name);
+	}
+	this->NextToken();
+	if (m_fingerprint) {
+	    // The call is lowered against the callee's signature, which
+	    // the caller's own tokens don't spell out.
+	    m_fingerprint->update(returnType->GetName());
+	    for (auto type : paramTypes) {
+		m_fingerprint->update(llvm::StringRef("", 1));
+		m_fingerprint->update(type->GetName());
+	    }
+	    m_fingerprint->update(llvm::StringRef("", 1));
 	}
-	return {std::move(valueStack.top().node), valueStack.top().type};
+	return {m_arena.Make<ast::Call>(GetName(callee.text), returnType,
+				       m_arena.MakeArray(std::vector<const Type *>(paramTypes)),
+				       m_arena.MakeArray(std::move(args))),
+		returnType};
     }
     
+    Parser::ExprInfo Parser::ParseIndex(const TokenInfo & array, const Token exprend) {
+	auto var = m_varTable.find(array.text);
+	if (var == m_varTable.end() || !var->second.type->IsArray()) {
+	    Error(GetText(array.text) + " is not an array");
+	}
+	this->NextToken();
+	auto index = this->ParseBinaryExpr(exprend, 1);
+	if (index.type != &Type::Int) {
+	    Error("Array index must be an int");
+	}
+	if (m_currentToken.id != Token::RBRACKET) {
+	    Error("Expected ]");
+	}
+	this->NextToken();
+	return {m_arena.Make<ast::Index>(GetName(array.text), std::move(index.node)),
+		var->second.type->GetElementType()};
+    }
+
+    ast::NodeRef Parser::ParseAssign() {
+	const Symbol name = m_currentToken.text;
+	auto var = m_varTable.find(name);
+	if (var == m_varTable.end()) {
+	    Error("Attempt to reference nonexistent variable " + GetText(name));
+	}
+	if (var->second.type->IsArray()) {
+	    Error("Array " + GetText(name) + " can't be assigned, only its elements");
+	}
+	if (!var->second.isMutable) {
+	    Error(GetText(name) + " can't be assigned, declare it with mut var");
+	}
+	this->Expect(Token::ASSIGN, "Expected =");
+	this->NextToken();
+	auto value = this->ParseExpression<Token::EXPREND>();
+	const Type * valueType = llvm::cast<ast::Expr>(*value).GetType();
+	if (valueType != var->second.type) {
+	    Error("Attempt to assign " + valueType->GetName() + " to " +
+		  var->second.type->GetName() + " " + GetText(name));
+	}
+	return m_arena.Make<ast::Assign>(GetName(name), std::move(value));
+    }
+
+    ast::NodeRef Parser::ParseElementAssign() {
+	const Symbol name = m_currentToken.text;
+	auto var = m_varTable.find(name);
+	if (var == m_varTable.end()) {
+	    Error("Attempt to reference nonexistent variable " + GetText(name));
+	}
+	if (!var->second.type->IsArray()) {
+	    Error(GetText(name) + " is not an array");
+	}
+	if (!var->second.isMutable) {
+	    Error("Elements of " + GetText(name) + " can't be assigned, declare it with mut var");
+	}
+	const Type * elementType = var->second.type->GetElementType();
+	this->Expect(Token::LBRACKET, "Expected [");
+	this->NextToken();
+	auto index = this->ParseExpression<Token::RBRACKET>();
+	if (llvm::cast<ast::Expr>(*index).GetType() != &Type::Int) {
+	    Error("Array index must be an int");
+	}
+	this->Expect(Token::ASSIGN, "Expected =");
+	this->NextToken();
+	auto value = this->ParseExpression<Token::EXPREND>();
+	const Type * valueType = llvm::cast<ast::Expr>(*value).GetType();
+	if (valueType != elementType) {
+	    Error("Attempt to assign " + valueType->GetName() + " to an element of " +
+		  var->second.type->GetName() + " " + GetText(name));
+	}
+	return m_arena.Make<ast::ElementAssign>(GetName(name), std::move(index),
+						std::move(value));
+    }
+
+    ast::NodeRef Parser::ParseCallStatement() {
+	auto exprNode = this->ParseExpression<Token::EXPREND>();
+	if (!llvm::isa<ast::Call>(llvm::cast<ast::Expr>(*exprNode).GetSubTree())) {
+	    Error("Only a call can be used as a statement");
+	}
+	return exprNode;
+    }
+
     ast::NodeRef Parser::ParseReturn() {
 	this->NextToken();
 	auto exprNode = this->ParseExpression<Token::EXPREND>();
-	auto expr = dynamic_cast<ast::Expr *>(exprNode.get());
-	assert(expr);
-	if (m_currentFunction.returnType == "") {
+	auto expr = llvm::cast<ast::Expr>(exprNode.get());
+	if (!m_currentFunction.returnType) {
 	    m_currentFunction.returnType = expr->GetType();
 	} else {
 	    if (m_currentFunction.returnType != expr->GetType()) {
 		const std::string errMsg = "Return type mismatch in function " +
-		    m_currentFunction.name + ": " + expr->GetType() + " and " +
-		    m_currentFunction.returnType;
+		    m_currentFunction.name + ": " + expr->GetType()->GetName() + " and " +
+		    m_currentFunction.returnType->GetName();
 		Error(errMsg);
 	    }
 	}
-	if (expr->GetType() == "void") {
-	    return ast::NodeRef(new ast::Return(ast::NodeRef(new ast::Void)));
+	if (expr->GetType() == &Type::Void && !expr->HasSubTree()) {
+	    return m_arena.Make<ast::Return>(m_arena.Make<ast::Void>());
 	} else {
-	    return ast::NodeRef(new ast::Return(std::move(exprNode)));
+	    // A call to a void function still has to be made.
+	    return m_arena.Make<ast::Return>(std::move(exprNode));
 	}
     }
     
@@ -224,13 +406,12 @@ namespace coralc {
 	ast::NodeRef rangeStart(nullptr);
 	ast::NodeRef rangeEnd(nullptr);
 	this->Expect(Token::IDENT, "Expected identifier");
-	std::string loopVarName = m_currentToken.text;
-	ast::NodeRef declLoopVar(new ast::Ident(loopVarName));
+	const Symbol loopVarName = m_currentToken.text;
+	auto declLoopVar = m_arena.Make<ast::Ident>(GetName(loopVarName));
 	if (m_varTable.find(loopVarName) != m_varTable.end()) {
-	     Error("Declaration of " + loopVarName + " would create a shadowing condition");
+	     Error("Declaration of " + GetText(loopVarName) +
+		   " would create a shadowing condition");
 	}
-	m_varTable[loopVarName].type = "int";
-	m_varTable[loopVarName].isMutable = false;
 	this->Expect(Token::IN, "Expected in");
 	this->NextToken();
 	bool reverse = false;
@@ -238,38 +419,18 @@ namespace coralc {
 	    reverse = true;
 	    this->NextToken();
 	}
-	switch (m_currentToken.id) {
-	case Token::INTEGER:
-	    rangeStart = ast::NodeRef(new ast::Integer(std::stoi(m_currentToken.text)));
-	    break;
-
-	case Token::IDENT:
-	    rangeStart = ast::NodeRef(new ast::Ident(m_currentToken.text));
-	    break;
-
-	default:
-	    Error("Expected integer or identifier");
-	    break;
-	}
+	rangeStart = this->ParseRangeBound();
 	this->Expect(Token::RANGE, "Expected ..");
 	this->NextToken();
-	switch (m_currentToken.id) {
-	case Token::INTEGER:
-	    rangeEnd = ast::NodeRef(new ast::Integer(std::stoi(m_currentToken.text)));
-	    break;
-
-	case Token::IDENT:
-	    rangeEnd = ast::NodeRef(new ast::Ident(m_currentToken.text));
-	    break;
-
-	default:
-	    Error("Expected integer or identifier");
-	}
+	rangeEnd = this->ParseRangeBound();
+	// Declared after the bounds, which can't refer to it.
+	m_varTable[loopVarName].type = &Type::Int;
+	m_varTable[loopVarName].isMutable = false;
 	if (reverse) {
 	    std::swap(rangeStart, rangeEnd);
 	}
-        auto decl = std::make_unique<ast::DeclIntVar>(std::move(declLoopVar),
-						      std::move(rangeStart));
+	auto decl = m_arena.Make<ast::DeclIntVar>(std::move(declLoopVar),
+						  std::move(rangeStart), false);
 	this->Expect(Token::DO, "Expected do");
 	this->NextToken();
 	auto scope = this->ParseScope();
@@ -277,54 +438,148 @@ namespace coralc {
 	if (m_currentToken.id != Token::END) {
 	    Error("Expected end");
 	}
-	return ast::NodeRef(new ast::ForLoop(std::move(decl),
-					     std::move(rangeEnd),
-					     std::move(scope),
-					     reverse));
+	return m_arena.Make<ast::ForLoop>(std::move(decl),
+					  std::move(rangeEnd),
+					  std::move(scope),
+					  reverse);
+    }
+
+    ast::NodeRef Parser::ParseRangeBound() {
+	switch (m_currentToken.id) {
+	case Token::INTEGER:
+	    return m_arena.Make<ast::Integer>(this->ParseInteger(m_currentToken.text));
+
+	case Token::IDENT: {
+	    auto var = m_varTable.find(m_currentToken.text);
+	    if (var == m_varTable.end()) {
+		Error("Attempt to reference nonexistent variable " +
+		      GetText(m_currentToken.text));
+	    }
+	    if (var->second.type != &Type::Int) {
+		Error("Range bounds must be ints");
+	    }
+	    return m_arena.Make<ast::Ident>(GetName(m_currentToken.text));
+	}
+
+	default:
+	    Error("Expected integer or identifier");
+	    return nullptr;
+	}
     }
 
     ast::NodeRef Parser::ParseFunctionDef() {
-	m_currentFunction.returnType = "";
+	m_currentFunction.returnType = nullptr;
+	llvm::MD5 fingerprint;
+	m_fingerprint = &fingerprint;
 	this->Expect(Token::IDENT, "Expected identifier");
-	std::string fname = m_currentToken.text;
+	const Symbol fsymbol = m_currentToken.text;
+	std::string fname = GetText(fsymbol);
+	if (m_functions.find(fsymbol) != m_functions.end()) {
+	    Error("Redefinition of function " + fname);
+	}
 	m_currentFunction.name = fname;
+	m_currentFunction.symbol = fsymbol;
+	m_currentFunction.callsItself = false;
 	this->Expect(Token::LPRN, "Expected (");
-	// TODO: function parameters... !!!
-	this->Expect(Token::RPRN, "Expected )");
+	auto params = this->ParseParameters();
+	auto & signature = m_functions[fsymbol];
+	signature = {nullptr, {}, nullptr};
+	for (auto & param : params) {
+	    signature.paramTypes.push_back(param.type);
+	}
 	this->NextToken();
-	auto scope = this->ParseScope();
-	const bool hasExplicitReturnStatement = m_currentFunction.returnType != "";
+	auto statements = this->ParseStatements();
+	// Only the parameters are left.
+	m_varTable.clear();
+	const bool hasExplicitReturnStatement = m_currentFunction.returnType != nullptr;
 	if (hasExplicitReturnStatement) {
-	    if (!scope->GetChildren().empty()) {
-	        auto ret =
-		    dynamic_cast<ast::Return *>(scope->GetChildren().back().get());
-		if (!ret) {
-		    if (m_currentFunction.returnType == "void") {
+	    if (!statements.empty()) {
+		if (!llvm::isa<ast::Return>(statements.back().get())) {
+		    if (m_currentFunction.returnType == &Type::Void) {
 			auto implicitVoidRet =
-			    ast::NodeRef(new ast::Return(ast::NodeRef(new ast::Void)));
-			scope->AddChild(std::move(implicitVoidRet));
+			    m_arena.Make<ast::Return>(m_arena.Make<ast::Void>());
+			statements.push_back(std::move(implicitVoidRet));
 		    } else {
 			Error("Missing return in non-void function");
 		    }
 		}
 	    }
 	} else /* !hasExplicitReturnStatement */ {
-	    m_currentFunction.returnType = "void";
-	    scope->AddChild(ast::NodeRef(new ast::Return(ast::NodeRef(new ast::Void))));
+	    m_currentFunction.returnType = &Type::Void;
+	    statements.push_back(m_arena.Make<ast::Return>(m_arena.Make<ast::Void>()));
 	}
 	if (m_currentToken.id != Token::END) {
 	    Error("Expected end");
 	}
-	return ast::NodeRef(new ast::Function(std::move(scope),
-					      fname, m_currentFunction.returnType));
+	m_fingerprint = nullptr;
+	llvm::MD5::MD5Result result;
+	fingerprint.final(result);
+	llvm::SmallString<32> digest;
+	llvm::MD5::stringifyResult(result, digest);
+	auto function = m_arena.Make<ast::Function>(
+	    m_arena.Make<ast::Scope>(m_arena.MakeArray(std::move(statements))),
+	    GetName(fsymbol), m_currentFunction.returnType,
+	    m_arena.MakeArray(std::move(params)));
+	function->SetFingerprint(m_arena.CopyString(digest));
+	if (m_currentFunction.callsItself) {
+	    function->SetCalled();
+	}
+	signature.returnType = m_currentFunction.returnType;
+	signature.node = function.get();
+	m_currentFunction.symbol = 0;
+	return std::move(function);
+    }
+
+    // Parameters are written name: type and are immutable, like var.
+    std::vector<ast::Parameter> Parser::ParseParameters() {
+	std::vector<ast::Parameter> params;
+	this->NextToken();
+	while (m_currentToken.id != Token::RPRN) {
+	    if (m_currentToken.id != Token::IDENT) {
+		Error("Expected parameter name");
+	    }
+	    const Symbol name = m_currentToken.text;
+	    if (m_varTable.find(name) != m_varTable.end()) {
+		Error("Duplicate parameter " + GetText(name));
+	    }
+	    this->Expect(Token::COLON, "Expected : after parameter name");
+	    const Type * type = this->ParseType();
+	    m_varTable[name].type = type;
+	    m_varTable[name].isMutable = false;
+	    params.push_back({GetName(name), type});
+	    this->NextToken();
+	    if (m_currentToken.id == Token::COMMA) {
+		this->NextToken();
+	    } else if (m_currentToken.id != Token::RPRN) {
+		Error("Expected , or )");
+	    }
+	}
+	return params;
+    }
+
+    const Type * Parser::LookupType(const Symbol name) const {
+	return llvm::StringSwitch<const Type *>(m_symbols.GetText(name))
+	    .Case("int", &Type::Int)
+	    .Case("float", &Type::Float)
+	    .Case("bool", &Type::Bool)
+	    .Default(nullptr);
+    }
+
+    const Type * Parser::ParseType() {
+	this->Expect(Token::IDENT, "Expected type");
+	const auto type = this->LookupType(m_currentToken.text);
+	if (!type) {
+	    Error("Unknown type " + GetText(m_currentToken.text));
+	}
+	return type;
     }
 
     ast::NodeRef Parser::ParseTopLevelScope() {
-	auto topLevel = std::make_unique<ast::GlobalScope>();
+	std::vector<ast::NodeRef> functions;
 	do {
 	    switch (m_currentToken.id) {
 	    case Token::DEF:
-		topLevel->AddChild(this->ParseFunctionDef());
+		functions.push_back(this->ParseFunctionDef());
 		break;
 
 	    case Token::VAR:
@@ -338,103 +593,155 @@ namespace coralc {
 	    }
 	    this->NextToken();
 	} while (m_currentToken.id != Token::ENDOFFILE);
-	return ast::NodeRef(topLevel.release());
+	return m_arena.Make<ast::GlobalScope>(m_arena.MakeArray(std::move(functions)));
     }
 
-    ast::NodeRef Parser::ParseIf() {
-        this->NextToken();
-	auto initCond = this->ParseExpression<Token::THEN>();
-	this->NextToken();	
-	auto ifElseChain =
-	    std::make_unique<ast::IfElseChain>(ast::Conditional(this->ParseScope(),
-								std::move(initCond)));
-	if (m_currentToken.id == Token::END) {
-	    return ast::NodeRef(ifElseChain.release());
+    ast::NodeRef Parser::ParseCondition() {
+	this->NextToken();
+	auto cond = this->ParseExpression<Token::THEN>();
+	// An empty condition has type void, so this rejects it too.
+	if (llvm::cast<ast::Expr>(*cond).GetType() != &Type::Bool) {
+	    Error("Condition must be bool");
 	}
+	this->NextToken();
+	return cond;
+    }
+
+    ast::NodeRef Parser::ParseIf() {
+	auto initCond = this->ParseCondition();
+	ast::Conditional ifConditional(this->ParseScope(), std::move(initCond));
+	std::vector<ast::Conditional> elseifs;
 	while (m_currentToken.id == Token::ELSEIF) {
-	    this->NextToken();
-	    auto midCond = this->ParseExpression<Token::THEN>();
-	    this->NextToken();
-	    ifElseChain->InsertElseif(ast::Conditional(this->ParseScope(), std::move(midCond)));
-	    if (m_currentToken.id == Token::END) {
-		return ast::NodeRef(ifElseChain.release());
-	    }
+	    auto midCond = this->ParseCondition();
+	    elseifs.emplace_back(this->ParseScope(), std::move(midCond));
 	}
+	ast::ScopeRef elseScope;
 	if (m_currentToken.id == Token::ELSE) {
 	    this->NextToken();
-	    ifElseChain->SetElse(this->ParseScope());
+	    elseScope = this->ParseScope();
 	}
 	if (m_currentToken.id != Token::END) {
 	    Error("Expected end");
 	}
-	return ast::NodeRef(ifElseChain.release());
+	return m_arena.Make<ast::IfElseChain>(std::move(ifConditional),
+					      m_arena.MakeArray(std::move(elseifs)),
+					      std::move(elseScope));
     }
 
     ast::NodeRef Parser::ParseDeclVar(const bool mut) {
 	this->Expect(Token::IDENT, "Expected identifier after var");
-	std::string identName = m_currentToken.text;
-	auto ident = ast::NodeRef(new ast::Ident(identName));
+	const Symbol identName = m_currentToken.text;
+	auto ident = m_arena.Make<ast::Ident>(GetName(identName));
 	if (m_varTable.find(identName) != m_varTable.end()) {
 	    if (m_localVars->find(identName) != m_localVars->end()) {
-		Error("Re-declaration of " + identName);
+		Error("Re-declaration of " + GetText(identName));
 	    } else {
-		Error("Declaration of " + identName + " would create a shadowing condition");
+		Error("Declaration of " + GetText(identName) +
+		      " would create a shadowing condition");
 	    }
 	}
 	m_localVars->insert(identName);
 	this->Expect(Token::ASSIGN, "Expected =");
 	this->NextToken();
+	if (m_currentToken.id == Token::IDENT && this->LookupType(m_currentToken.text)) {
+	    Lexer lookahead = m_lexer;
+	    if (lookahead.Next() == Token::LBRACKET) {
+		return this->ParseDeclArray(std::move(ident), identName, mut);
+	    }
+	}
 	auto expr = this->ParseExpression<Token::EXPREND>();
-	auto & exprType = dynamic_cast<ast::Expr *>(expr.get())->GetType();
-	if (exprType == "int") {
-	    m_varTable[identName].type = "int";
+	auto exprType = llvm::cast<ast::Expr>(expr.get())->GetType();
+	if (exprType == &Type::Int) {
+	    m_varTable[identName].type = &Type::Int;
 	    m_varTable[identName].isMutable = mut;
-	    return ast::NodeRef(new ast::DeclIntVar(std::move(ident),
-						    std::move(expr)));
-	} else if (exprType == "float") {
-	    m_varTable[identName].type = "float";
+	    return m_arena.Make<ast::DeclIntVar>(std::move(ident),
+						 std::move(expr), mut);
+	} else if (exprType == &Type::Float) {
+	    m_varTable[identName].type = &Type::Float;
 	    m_varTable[identName].isMutable = mut;
-	    return ast::NodeRef(new ast::DeclFloatVar(std::move(ident),
-						      std::move(expr)));
-	} else if (exprType == "bool") {
-	    m_varTable[identName].type = "bool";
+	    return m_arena.Make<ast::DeclFloatVar>(std::move(ident),
+						   std::move(expr), mut);
+	} else if (exprType == &Type::Bool) {
+	    m_varTable[identName].type = &Type::Bool;
 	    m_varTable[identName].isMutable = mut;
-	    return ast::NodeRef(new ast::DeclBooleanVar(std::move(ident),
-							std::move(expr)));
-	} else if (exprType == "void") {
+	    return m_arena.Make<ast::DeclBooleanVar>(std::move(ident),
+						     std::move(expr), mut);
+	} else if (exprType == &Type::Void) {
 	    Error("Attempt to bind void to an l-value");
 	} else {
 	    Error("Unknown type");
 	}
     }
     
+    ast::NodeRef Parser::ParseDeclArray(ast::NodeRef ident, const Symbol name,
+					const bool mut) {
+	const Type * elementType = this->LookupType(m_currentToken.text);
+	this->Expect(Token::LBRACKET, "Expected [");
+	this->NextToken();
+	auto length = this->ParseExpression<Token::RBRACKET>();
+	if (llvm::cast<ast::Expr>(*length).GetType() != &Type::Int) {
+	    Error("Array length must be an int");
+	}
+	const auto literal =
+	    llvm::dyn_cast<ast::Integer>(&llvm::cast<ast::Expr>(*length).GetSubTree());
+	if (literal && literal->GetValue() <= 0) {
+	    Error("Array length must be positive");
+	}
+	this->Expect(Token::EXPREND, "Expected ;");
+	m_varTable[name].type = Type::GetArrayType(*elementType);
+	m_varTable[name].isMutable = mut;
+	return m_arena.Make<ast::DeclArray>(std::move(ident), std::move(length), mut,
+					    elementType);
+    }
+
     ast::ScopeRef Parser::ParseScope() {
-	std::set<std::string> localVars;
-	std::set<std::string> * parentScopeVars;
+	return m_arena.Make<ast::Scope>(m_arena.MakeArray(this->ParseStatements()));
+    }
+
+    std::vector<ast::NodeRef> Parser::ParseStatements() {
+	std::set<Symbol> localVars;
+	std::set<Symbol> * parentScopeVars;
 	parentScopeVars = m_localVars;
 	m_localVars = &localVars;
 	bool unreachable = false;
-	ast::ScopeRef scope(new ast::Scope);
+	std::vector<ast::NodeRef> statements;
 	do {
 	    if (!unreachable) {
 		switch (m_currentToken.id) {
 		case Token::FOR: {
-		    scope->AddChild(this->ParseFor());
+		    statements.push_back(this->ParseFor());
 		} break;
 		    
 		case Token::VAR:
-		    scope->AddChild(this->ParseDeclVar(false));
+		    statements.push_back(this->ParseDeclVar(false));
 		    break;
 		    
 		case Token::MUT:
 		    this->Expect(Token::VAR, "Expected var");
-		    scope->AddChild(this->ParseDeclVar(false));
+		    statements.push_back(this->ParseDeclVar(true));
 		    break;
 
 		case Token::IF:
-		    scope->AddChild(this->ParseIf());
+		    statements.push_back(this->ParseIf());
 		    break;
 
+		case Token::IDENT: {
+		    Lexer lookahead = m_lexer;
+		    switch (lookahead.Next()) {
+		    case Token::LPRN:
+			statements.push_back(this->ParseCallStatement());
+			break;
+
+		    case Token::LBRACKET:
+			statements.push_back(this->ParseElementAssign());
+			break;
+
+		    default:
+			statements.push_back(this->ParseAssign());
+			break;
+		    }
+		} break;
+
 		    // Note: because all three tokens can terminate
 		    // a scope, callers must check that the correct
 		    // token exists depending on context
@@ -454,12 +761,12 @@ namespace coralc {
 		    unreachable = true;
 		    {
 			auto ret = this->ParseReturn();
-			scope->AddChild(std::move(ret));
+			statements.push_back(std::move(ret));
 		    }
 		    break;
 
 		default: {
-		    Error(m_currentToken.text);
+		    Error(GetText(m_currentToken.text));
 		} break;
 		}
 	    } else {
@@ -478,24 +785,36 @@ namespace coralc {
 	    m_varTable.erase(element);
 	}
 	m_localVars = parentScopeVars;
-	return scope;
+	return statements;
     }
     
-    ast::NodeRef Parser::Parse(const std::string & sourceFile) {
-	yy_scan_string(sourceFile.c_str());
+    ast::NodeRef Parser::Parse(const SourceFile & sourceFile) {
+	const char * data = sourceFile.GetData();
+	m_lexer = Lexer(data, data + sourceFile.GetSize());
 	this->NextToken();
 	ast::NodeRef astRoot(nullptr);
 	try {
 	    astRoot = this->ParseTopLevelScope();
 	} catch (const std::exception & ex) {
-	    std::cerr << ex.what() << std::endl;
-	    throw std::runtime_error("Compilation failed");
+	    // The message is handed back rather than printed, so that a
+	    // driver compiling several files at once can report each
+	    // file's errors in order.
+	    throw std::runtime_error(std::string(ex.what()) + "\nCompilation failed");
 	}
-	yy_free_current_buffer();
 	return astRoot;
     }
 
     void Parser::NextToken() {
-	m_currentToken = TokenInfo{static_cast<Token>(yylex()), std::string(yytext)};
+	const auto id = m_lexer.Next();
+	m_currentToken = TokenInfo{id, m_symbols.Intern(m_lexer.GetText())};
+	if (m_fingerprint) {
+	    // Whitespace and comments are left out, so that only edits
+	    // which can change the generated code change the hash. The
+	    // NUL keeps adjacent tokens from running together.
+	    const uint8_t tokenId = static_cast<uint8_t>(id);
+	    m_fingerprint->update(tokenId);
+	    m_fingerprint->update(m_lexer.GetText());
+	    m_fingerprint->update(llvm::StringRef("", 1));
+	}
     }
 }
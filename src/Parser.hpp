@@ -5,9 +5,7 @@
 #include <utility>
 #include <iostream>
 #include <vector>
-#include <queue>
 #include <stack>
-#include <deque>
 #include <memory>
 #include <ostream>
 #include <functional>
@@ -15,185 +13,95 @@
 #include <array>
 #include <exception>
 #include "ast.hpp"
+#include "Lexer.hpp"
+#include "llvm/Support/MD5.h"
+#include "SourceFile.hpp"
+#include "SymbolTable.hpp"
 
 namespace coralc {
     class Parser {
     public:
-	Parser();
-	ast::NodeRef Parse(const std::string &);
+	// The syntax tree returned by Parse is allocated from the arena.
+	explicit Parser(ast::Arena &);
+	// The lexer reads the file's buffer in place without copying it.
+	ast::NodeRef Parse(const SourceFile &);
     
     private:
-	enum class Token {
-	    ENDOFFILE,
-	    FOR,
-	    IN,
-	    IF,
-	    THEN,
-	    ELSE,
-	    ELSEIF,
-	    DO,
-	    RANGE,
-	    EXPREND,
-	    END,
-	    VAR,
-	    REVERSE,
-	    DEF,
-	    ASSIGN,
-	    COMMA,
-	    LBRACE,
-	    RBRACE,
-	    ADD,
-	    SUBTRACT,
-	    MULTIPLY,
-	    DIVIDE,
-	    MODULUS,
-	    EQUALITY,
-	    INEQUALITY,
-	    BOOLEAN,
-	    RETURN,
-	    MUT,
-	    HASH,
-	    LPRN,
-	    RPRN,
-	    AND,
-	    OR,
-	    STRING,
-	    FLOAT,
-	    INTEGER,
-	    MODULE,
-	    IDENT
-	};
 	struct TokenInfo {
 	    Token id;
-	    std::string text;
+	    Symbol text;
 	};
 	struct FunctionInfo {
 	    std::string name;
-	    std::string returnType;
+	    Symbol symbol;
+	    // Null until deduced from the first return statement.
+	    const Type * returnType;
+	    bool callsItself;
+	};
+	// Functions can only call functions defined before them, and
+	// themselves.
+	struct Signature {
+	    const Type * returnType;
+	    std::vector<const Type *> paramTypes;
+	    ast::Function * node;
 	};
 	void Error(const std::string &);
-	template <Parser::Token Exprend>
-	std::deque<Parser::TokenInfo> ParseExprToRPN() {
-	    // Shunting Yard algorithm
-	    std::stack<TokenInfo> operatorStack;
-	    std::deque<TokenInfo> outputQueue;
-	    const auto precedence =
-		[this](Token t) {
-		    switch (t) {
-		    case Token::MULTIPLY: return 4;
-		    case Token::DIVIDE: return 4;
-		    case Token::MODULUS: return 4;
-		    case Token::ADD: return 3;
-		    case Token::SUBTRACT: return 3;
-		    case Token::EQUALITY: return 2;
-		    case Token::INEQUALITY: return 2;
-		    case Token::AND: return 1;
-		    case Token::OR: return 1;
-			// Contents within paretheses are executed first,
-			// but the parentheses themselves have a low
-			// precedence in the context of this algorithm.
-		    case Token::LPRN:
-		    case Token::RPRN: return 0;
-		    default: this->Error("Unexpected token"); return 0;
-		    }
-		};
-	    do {
-		switch (m_currentToken.id) {
-		case Exprend:
-		    while (!operatorStack.empty()) {
-			if (operatorStack.top().id == Token::LPRN ||
-			    operatorStack.top().id == Token::RPRN) {
-			    this->Error("Mis-matched parentheses");
-			}
-			outputQueue.push_back(operatorStack.top());
-			operatorStack.pop();
-		    }
-		    return outputQueue;
-
-		case Token::ASSIGN:
-		    Error("Assignment not allowed in rhs expression");
-		    break;
-		    
-		case Token::END:
-		case Token::ENDOFFILE:
-		    Error("Expression missing terminator");
-		    break;
-
-		case Token::LPRN:
-		    operatorStack.push(m_currentToken);
-		    break;
-
-		case Token::RPRN:
-		    while (!operatorStack.empty()) {
-			if (operatorStack.top().id == Token::LPRN) {
-			    operatorStack.pop();
-			    break;
-			} else {
-			    outputQueue.push_back(operatorStack.top());
-			    operatorStack.pop();
-			}
-			if (operatorStack.empty()) {
-			    this->Error("Mis-matched parentheses");
-			}
-		    }
-		    break;
-		    
-		case Token::INTEGER:
-		case Token::FLOAT:
-		case Token::IDENT:
-		case Token::BOOLEAN:
-		    outputQueue.push_back(m_currentToken);
-		    break;
-
-		case Token::OR:
-		case Token::AND:
-		case Token::ADD:
-		case Token::DIVIDE:
-		case Token::MODULUS:
-		case Token::SUBTRACT:
-		case Token::MULTIPLY:
-		case Token::EQUALITY:
-		case Token::INEQUALITY:
-		    while (!operatorStack.empty() && precedence(operatorStack.top().id)
-			   >= precedence(m_currentToken.id)) {
-			outputQueue.push_back(operatorStack.top());
-			operatorStack.pop();
-		    }
-		    operatorStack.push(m_currentToken);
-		    break;
-		}
-		this->NextToken();
-	    } while (true);
-	}
-	std::pair<ast::NodeRef, std::string>
-        MakeExprSubTree(std::deque<Parser::TokenInfo> &&);
+	struct ExprInfo {
+	    ast::NodeRef node;
+	    const Type * type;
+	};
+	// Precedence climbing: operands and operators are consumed in a
+	// single pass and each BinOp is built and type checked as soon as
+	// both of its operands are known.
+	ExprInfo ParseExpr(const Token exprend);
+	ExprInfo ParseBinaryExpr(const Token exprend, const int minPrecedence);
+	ExprInfo ParsePrimaryExpr(const Token exprend);
+	ExprInfo MakeBinOp(const Token op, ExprInfo lhs, ExprInfo rhs);
+	ExprInfo ParseCall(const TokenInfo & callee, const Token exprend);
+	ExprInfo ParseIndex(const TokenInfo & array, const Token exprend);
+	static int BinaryPrecedence(const Token);
 	ast::NodeRef ParseDeclVar(const bool);
+	ast::NodeRef ParseDeclArray(ast::NodeRef ident, const Symbol, const bool);
+	ast::NodeRef ParseAssign();
+	ast::NodeRef ParseElementAssign();
+	ast::NodeRef ParseCallStatement();
 	template <Token Exprend>
 	ast::NodeRef ParseExpression() {
-	    auto exprQueueRPN = this->ParseExprToRPN<Exprend>();
-	    auto exprTreeInfo = MakeExprSubTree(std::move(exprQueueRPN));
-	    return ast::NodeRef(new ast::Expr(exprTreeInfo.second,
-					      std::move(exprTreeInfo.first)));
+	    auto exprInfo = this->ParseExpr(Exprend);
+	    return m_arena.Make<ast::Expr>(exprInfo.type, std::move(exprInfo.node));
 	}
 	ast::NodeRef ParseTopLevelScope();
 	ast::NodeRef ParseIf();
+	ast::NodeRef ParseCondition();
 	ast::NodeRef ParseFunctionDef();
+	std::vector<ast::Parameter> ParseParameters();
+	const Type * ParseType();
+	const Type * LookupType(const Symbol) const;
+	ast::NodeRef ParseRangeBound();
+	std::vector<ast::NodeRef> ParseStatements();
 	ast::ScopeRef ParseScope();
 	ast::NodeRef ParseReturn();
 	ast::NodeRef ParseFor();
 	void NextToken();
 	void Expect(const Token, const char *);
+	std::string GetText(const Symbol) const;
+	// The symbol's text, copied into the arena for nodes to refer to.
+	llvm::StringRef GetName(const Symbol);
+	int ParseInteger(const Symbol);
+	float ParseFloat(const Symbol) const;
+	ast::Arena & m_arena;
+	Lexer m_lexer;
+	// Fed every token while a function definition is being parsed.
+	llvm::MD5 * m_fingerprint;
+	SymbolTable m_symbols;
 	TokenInfo m_currentToken;
 	FunctionInfo m_currentFunction;
-	// Types are represented within the compiler as strings. I'm
-	// hoping that this will make lookups easier later for user
-	// defined types (classes). Maybe type could instead be a UID
-	// into a type table of strings, to save on memory.
+	std::map<Symbol, Signature> m_functions;
 	struct VarInfo {
-	    std::string type;
+	    const Type * type;
 	    bool isMutable;
 	};
-	std::map<std::string, VarInfo> m_varTable;
-	std::set<std::string> * m_localVars;
+	std::map<Symbol, VarInfo> m_varTable;
+	std::set<Symbol> * m_localVars;
     };
 }
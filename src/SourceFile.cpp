@@ -0,0 +1,54 @@
+#include "SourceFile.hpp"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace coralc {
+    SourceFile::SourceFile(const std::string & path) :
+	m_data(nullptr), m_size(0), m_mapped(false) {
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+	    throw std::runtime_error("Could not open file");
+	}
+	struct stat info;
+	if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+	    void * base = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	    if (base != MAP_FAILED) {
+		m_data = static_cast<const char *>(base);
+		m_size = info.st_size;
+		m_mapped = true;
+	    }
+	}
+	if (!m_mapped) {
+	    // Pipes, empty files, and anything else that can't be mapped.
+	    std::vector<char> contents;
+	    char chunk[4096];
+	    ssize_t count;
+	    while ((count = read(fd, chunk, sizeof(chunk))) > 0) {
+		contents.insert(contents.end(), chunk, chunk + count);
+	    }
+	    if (count < 0) {
+		close(fd);
+		throw std::runtime_error("Could not read file");
+	    }
+	    m_size = contents.size();
+	    char * buffer = new char[m_size];
+	    std::copy(contents.begin(), contents.end(), buffer);
+	    m_data = buffer;
+	}
+	close(fd);
+    }
+
+    SourceFile::~SourceFile() {
+	if (m_mapped) {
+	    munmap(const_cast<char *>(m_data), m_size);
+	} else {
+	    delete [] m_data;
+	}
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace coralc {
+    // A source file mapped read-only into memory. The lexer scans the
+    // mapping in place and never writes to it, so several parsers may
+    // share one SourceFile.
+    class SourceFile {
+	const char * m_data;
+	size_t m_size;
+	bool m_mapped;
+    public:
+	SourceFile(const std::string & path);
+	SourceFile(const SourceFile &) = delete;
+	SourceFile & operator=(const SourceFile &) = delete;
+	~SourceFile();
+	const char * GetData() const {
+	    return m_data;
+	}
+	size_t GetSize() const {
+	    return m_size;
+	}
+    };
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+
+namespace coralc {
+    using Symbol = uint32_t;
+
+    // Interns token text so that each distinct spelling is stored once
+    // and tokens can refer to it through a 4 byte handle. Interned text
+    // is NUL terminated and lives as long as the table.
+    class SymbolTable {
+	llvm::StringMap<Symbol> m_ids;
+	std::vector<llvm::StringRef> m_text;
+    public:
+	// Symbol 0 is always the empty string.
+	SymbolTable() {
+	    this->Intern("");
+	}
+	Symbol Intern(llvm::StringRef text) {
+	    auto entry = m_ids.insert({text, static_cast<Symbol>(m_text.size())});
+	    if (entry.second) {
+		m_text.push_back(entry.first->getKey());
+	    }
+	    return entry.first->getValue();
+	}
+	llvm::StringRef GetText(const Symbol symbol) const {
+	    return m_text[symbol];
+	}
+    };
+}
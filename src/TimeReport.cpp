@@ -0,0 +1,164 @@
+#include "TimeReport.hpp"
+
+#include "llvm/Support/Format.h"
+#include <sys/resource.h>
+#include <time.h>
+
+namespace coralc {
+    static const char * GetPhaseName(const TimeReport::Phase phase) {
+	switch (phase) {
+	case TimeReport::Phase::Read: return "read";
+	case TimeReport::Phase::Lex: return "lex";
+	case TimeReport::Phase::Parse: return "parse";
+	case TimeReport::Phase::Fold: return "fold";
+	case TimeReport::Phase::CodeGen: return "codegen";
+	case TimeReport::Phase::Optimize: return "optimize";
+	case TimeReport::Phase::Emit: return "emit";
+	case TimeReport::Phase::Link: return "link";
+	default: return "";
+	}
+    }
+
+    static double TimevalToMs(const timeval & time) {
+	return time.tv_sec * 1000.0 + time.tv_usec / 1000.0;
+    }
+
+    // CPU time of the whole process, and its peak resident set size.
+    static void GetProcessUsage(double & cpuMs, uint64_t & peakRSSKb) {
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	cpuMs = TimevalToMs(usage.ru_utime) + TimevalToMs(usage.ru_stime);
+	// Linux reports ru_maxrss in kilobytes.
+	peakRSSKb = usage.ru_maxrss;
+    }
+
+    // Source lines and megabytes processed per second of wall time.
+    static double LinesPerSecond(const TimeReport::Counts & counts, const double wallMs) {
+	return wallMs > 0 ? counts.lines / (wallMs / 1000) : 0;
+    }
+
+    static double MBPerSecond(const TimeReport::Counts & counts, const double wallMs) {
+	return wallMs > 0 ? counts.bytes / (1024.0 * 1024.0) / (wallMs / 1000) : 0;
+    }
+
+    static void PrintRow(llvm::raw_ostream & os, const char * name, const double wallMs,
+			 const double cpuMs, const TimeReport::Counts & counts) {
+	os << llvm::format("  %-10s %12.3f %12.3f %14.0f %10.2f\n", name, wallMs, cpuMs,
+			   LinesPerSecond(counts, wallMs), MBPerSecond(counts, wallMs));
+    }
+
+    static void PrintJSONTimes(llvm::raw_ostream & os, const double wallMs,
+			       const double cpuMs, const TimeReport::Counts & counts) {
+	os << llvm::format("{\"wall_ms\": %.3f, \"cpu_ms\": %.3f, "
+			   "\"lines_per_s\": %.0f, \"mb_per_s\": %.3f}",
+			   wallMs, cpuMs, LinesPerSecond(counts, wallMs),
+			   MBPerSecond(counts, wallMs));
+    }
+
+    TimeReport::TimeReport() : m_start(std::chrono::steady_clock::now()) {}
+
+    void TimeReport::AddTime(const Phase phase, const double wallMs, const double cpuMs) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto & times = m_times[static_cast<size_t>(phase)];
+	times.wallMs += wallMs;
+	times.cpuMs += cpuMs;
+    }
+
+    void TimeReport::AddCount(uint64_t Counts::* count, const uint64_t n) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_counts.*count += n;
+    }
+
+    uint64_t TimeReport::CountInstructions(const llvm::Module & module) {
+	uint64_t count = 0;
+	for (auto & fn : module) {
+	    for (auto & block : fn) {
+		count += block.size();
+	    }
+	}
+	return count;
+    }
+
+    double TimeReport::GetThreadCPUTime() {
+	timespec time;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+	return time.tv_sec * 1000.0 + time.tv_nsec / 1e6;
+    }
+
+    void TimeReport::Print(llvm::raw_ostream & os) const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	const double totalWallMs = std::chrono::duration<double, std::milli>(
+	    std::chrono::steady_clock::now() - m_start).count();
+	double totalCPUMs;
+	uint64_t peakRSSKb;
+	GetProcessUsage(totalCPUMs, peakRSSKb);
+	os << "===- coralc time report -===\n"
+	   << "  phase         wall (ms)     cpu (ms)        lines/s       MB/s\n";
+	for (size_t i = 0; i < m_times.size(); ++i) {
+	    PrintRow(os, GetPhaseName(static_cast<Phase>(i)), m_times[i].wallMs,
+		     m_times[i].cpuMs, m_counts);
+	}
+	PrintRow(os, "total", totalWallMs, totalCPUMs, m_counts);
+	os << "  Phases that run in parallel partitions or files report the sum\n"
+	   << "  over all threads. The parser lexes as it goes, so lex is timed in\n"
+	   << "  a separate pass and parse includes lexing again.\n"
+	   << "  files:                " << m_counts.files << "\n"
+	   << "  lines:                " << m_counts.lines << "\n"
+	   << "  bytes:                " << m_counts.bytes << "\n"
+	   << "  tokens:               " << m_counts.tokens << "\n"
+	   << "  AST nodes:            " << m_counts.astNodes << "\n"
+	   << "  functions:            " << m_counts.functions << "\n"
+	   << "  IR instructions:      " << m_counts.irInstructions << " ("
+	   << m_counts.optimizedIRInstructions << " after optimization)\n"
+	   << "  peak RSS:             " << peakRSSKb << " KB\n";
+	os.flush();
+    }
+
+    void TimeReport::PrintJSON(llvm::raw_ostream & os) const {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	const double totalWallMs = std::chrono::duration<double, std::milli>(
+	    std::chrono::steady_clock::now() - m_start).count();
+	double totalCPUMs;
+	uint64_t peakRSSKb;
+	GetProcessUsage(totalCPUMs, peakRSSKb);
+	os << "{\n  \"phases\": {\n";
+	for (size_t i = 0; i < m_times.size(); ++i) {
+	    os << "    \"" << GetPhaseName(static_cast<Phase>(i)) << "\": ";
+	    PrintJSONTimes(os, m_times[i].wallMs, m_times[i].cpuMs, m_counts);
+	    os << (i + 1 < m_times.size() ? ",\n" : "\n");
+	}
+	os << "  },\n"
+	   << "  \"total\": ";
+	PrintJSONTimes(os, totalWallMs, totalCPUMs, m_counts);
+	os << ",\n"
+	   << "  \"counts\": {\n"
+	   << "    \"files\": " << m_counts.files << ",\n"
+	   << "    \"lines\": " << m_counts.lines << ",\n"
+	   << "    \"bytes\": " << m_counts.bytes << ",\n"
+	   << "    \"tokens\": " << m_counts.tokens << ",\n"
+	   << "    \"ast_nodes\": " << m_counts.astNodes << ",\n"
+	   << "    \"functions\": " << m_counts.functions << ",\n"
+	   << "    \"ir_instructions\": " << m_counts.irInstructions << ",\n"
+	   << "    \"optimized_ir_instructions\": " << m_counts.optimizedIRInstructions << "\n"
+	   << "  },\n"
+	   << "  \"peak_rss_kb\": " << peakRSSKb << "\n"
+	   << "}\n";
+	os.flush();
+    }
+
+    PhaseTimer::PhaseTimer(TimeReport * report, const TimeReport::Phase phase) :
+	m_report(report), m_phase(phase), m_cpuStart(0) {
+	if (m_report) {
+	    m_wallStart = std::chrono::steady_clock::now();
+	    m_cpuStart = TimeReport::GetThreadCPUTime();
+	}
+    }
+
+    PhaseTimer::~PhaseTimer() {
+	if (m_report) {
+	    const double wallMs = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - m_wallStart).count();
+	    m_report->AddTime(m_phase, wallMs, TimeReport::GetThreadCPUTime() - m_cpuStart);
+	}
+    }
+}
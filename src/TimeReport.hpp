@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include "llvm/IR/Module.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace coralc {
+    // Wall and CPU time spent in each phase of compilation, summed over
+    // every file and partition, along with the size of what was
+    // compiled. All members may be called from any thread.
+    class TimeReport {
+    public:
+	enum class Phase {
+	    Read,
+	    Lex,
+	    Parse,
+	    Fold,
+	    CodeGen,
+	    Optimize,
+	    Emit,
+	    Link,
+	    Count
+	};
+	struct Counts {
+	    uint64_t files = 0;
+	    // Size of the source that was compiled rather than found in
+	    // the cache, which each phase's throughput is relative to.
+	    uint64_t lines = 0;
+	    uint64_t bytes = 0;
+	    uint64_t tokens = 0;
+	    uint64_t astNodes = 0;
+	    uint64_t functions = 0;
+	    // Before and after the optimization pipeline.
+	    uint64_t irInstructions = 0;
+	    uint64_t optimizedIRInstructions = 0;
+	};
+	TimeReport();
+	void AddTime(const Phase, const double wallMs, const double cpuMs);
+	// Adds n to one of the counts, e.g. AddCount(&Counts::tokens, n).
+	void AddCount(uint64_t Counts::* count, const uint64_t n);
+	void Print(llvm::raw_ostream &) const;
+	void PrintJSON(llvm::raw_ostream &) const;
+	static uint64_t CountInstructions(const llvm::Module &);
+	// CPU time consumed by the calling thread.
+	static double GetThreadCPUTime();
+
+    private:
+	struct Times {
+	    double wallMs = 0;
+	    double cpuMs = 0;
+	};
+	mutable std::mutex m_mutex;
+	std::array<Times, static_cast<size_t>(Phase::Count)> m_times;
+	Counts m_counts;
+	std::chrono::steady_clock::time_point m_start;
+    };
+
+    // Charges the time between its construction and destruction to a
+    // phase. Does nothing when the report is null, so that call sites
+    // needn't check whether a report was requested.
+    class PhaseTimer {
+	TimeReport * m_report;
+	TimeReport::Phase m_phase;
+	std::chrono::steady_clock::time_point m_wallStart;
+	double m_cpuStart;
+    public:
+	PhaseTimer(TimeReport * report, const TimeReport::Phase phase);
+	PhaseTimer(const PhaseTimer &) = delete;
+	PhaseTimer & operator=(const PhaseTimer &) = delete;
+	~PhaseTimer();
+    };
+}
@@ -0,0 +1,23 @@
+#include "Type.hpp"
+
+namespace coralc {
+    const Type Type::Void(0, "void");
+    const Type Type::Int(1, "int");
+    const Type Type::Float(2, "float");
+    const Type Type::Bool(3, "bool");
+    const Type Type::IntArray(4, "int[]", &Type::Int);
+    const Type Type::FloatArray(5, "float[]", &Type::Float);
+    const Type Type::BoolArray(6, "bool[]", &Type::Bool);
+    constexpr unsigned Type::count;
+
+    const Type * Type::GetArrayType(const Type & elementType) {
+	if (&elementType == &Int) {
+	    return &IntArray;
+	} else if (&elementType == &Float) {
+	    return &FloatArray;
+	} else if (&elementType == &Bool) {
+	    return &BoolArray;
+	}
+	return nullptr;
+    }
+}
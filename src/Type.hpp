@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+
+namespace coralc {
+    // Types are interned: there is exactly one Type object for each
+    // type in the language, so they are passed around as pointers and
+    // compared by identity. The id indexes per-context caches of the
+    // matching llvm::Type (see LLVMState::GetLLVMType).
+    class Type {
+	unsigned m_id;
+	std::string m_name;
+	const Type * m_elementType;
+	Type(const unsigned id, const std::string & name, const Type * elementType = nullptr) :
+	    m_id(id), m_name(name), m_elementType(elementType) {}
+    public:
+	Type(const Type &) = delete;
+	Type & operator=(const Type &) = delete;
+	unsigned GetId() const {
+	    return m_id;
+	}
+	const std::string & GetName() const {
+	    return m_name;
+	}
+	bool IsArithmetic() const {
+	    return this == &Int || this == &Float;
+	}
+	// Arrays are contiguous runs of elements of one scalar type.
+	bool IsArray() const {
+	    return m_elementType != nullptr;
+	}
+	const Type * GetElementType() const {
+	    return m_elementType;
+	}
+	static const Type * GetArrayType(const Type & elementType);
+	static const Type Void;
+	static const Type Int;
+	static const Type Float;
+	static const Type Bool;
+	static const Type IntArray;
+	static const Type FloatArray;
+	static const Type BoolArray;
+	static constexpr unsigned count = 7;
+    };
+}
@@ -1,86 +1,353 @@
 #include "ast.hpp"
 
+#include "llvm/IR/Intrinsics.h"
+#include <cmath>
+#include <cstdint>
 #include <iostream>
+#include <limits>
 
 namespace coralc {
     namespace ast {
-	void Scope::AddChild(NodeRef child) {
-	    m_children.push_back(std::move(child));
-	}
+	Ident::Ident(llvm::StringRef name) : Node(Kind::Ident), m_name(name) {}
 
-	Ident::Ident(const std::string & name) : m_name(name) {}
+	Function::Function(ScopeRef scope, llvm::StringRef name,
+			   const Type * returnType, llvm::ArrayRef<Parameter> params) :
+	    Node(Kind::Function), ScopeProvider(std::move(scope)), m_name(name),
+	    m_returnType(returnType), m_params(params), m_isCalled(false) {}
 
-	Function::Function(ScopeRef scope, const std::string & name,
-			   const std::string & returnType) :
-	    ScopeProvider(std::move(scope)), m_name(name),
-	    m_returnType(returnType) {}
-	
-	const std::string & Ident::GetName() const {
-	    return m_name;
-	}
+	Index::Index(llvm::StringRef name, NodeRef index) :
+	    Node(Kind::Index), m_name(name), m_index(std::move(index)) {}
 
-	void IfElseChain::InsertElseif(Conditional && elseif) {
-	    m_elseifs.push_back(std::move(elseif));
-	}
+	Assign::Assign(llvm::StringRef name, NodeRef value) :
+	    Node(Kind::Assign), m_name(name), m_value(std::move(value)) {}
+
+	ElementAssign::ElementAssign(llvm::StringRef name, NodeRef index, NodeRef value) :
+	    Node(Kind::ElementAssign), m_name(name), m_index(std::move(index)),
+	    m_value(std::move(value)) {}
+
+	DeclArray::DeclArray(NodeRef ident, NodeRef length, const bool isMutable,
+			     const Type * elementType) :
+	    DeclVar(Kind::DeclArray, std::move(ident), std::move(length), isMutable),
+	    m_elementType(elementType), m_isFixedSize(false) {}
 
-	void IfElseChain::SetElse(ScopeRef _else) {
-	    m_else = std::move(_else);
+	Call::Call(llvm::StringRef name, const Type * returnType,
+		   llvm::ArrayRef<const Type *> paramTypes, llvm::MutableArrayRef<NodeRef> args) :
+	    Node(Kind::Call), m_name(name), m_returnType(returnType),
+	    m_paramTypes(paramTypes), m_args(args) {}
+	
+	llvm::StringRef Ident::GetName() const {
+	    return m_name;
 	}
 
-	Boolean::Boolean(const bool value) : m_value(value) {}
+	Boolean::Boolean(const bool value) : Node(Kind::Boolean), m_value(value) {}
 	
-	Return::Return(NodeRef value) : m_value(std::move(value)) {}
+	Return::Return(NodeRef value) : Node(Kind::Return), m_value(std::move(value)) {}
 	
-	Integer::Integer(const int value) : m_value(value) {}
+	Integer::Integer(const int value) : Node(Kind::Integer), m_value(value) {}
 
-	Float::Float(const float value) : m_value(value) {}
+	Float::Float(const float value) : Node(Kind::Float), m_value(value) {}
 	
 	ForLoop::ForLoop(NodeRef decl, NodeRef end, ScopeRef scope, const bool isReverse) :
+	    Node(Kind::ForLoop),
 	    ScopeProvider(std::move(scope)),
 	    m_decl(std::move(decl)),
 	    m_end(std::move(end)),
 	    m_isReverse(isReverse) {}
 
-	const std::string & ForLoop::GetIdentName() const {
-	    return dynamic_cast<DeclIntVar &>(*m_decl).GetIdentName();
+	llvm::StringRef ForLoop::GetIdentName() const {
+	    return llvm::cast<DeclIntVar>(*m_decl).GetIdentName();
 	}
 
-	DeclVar::DeclVar(NodeRef ident, NodeRef value) :
+	DeclVar::DeclVar(const Kind kind, NodeRef ident, NodeRef value, const bool isMutable) :
+	    Node(kind),
 	    m_ident(std::move(ident)),
-	    m_value(std::move(value)) {}
+	    m_value(std::move(value)),
+	    m_isMutable(isMutable) {}
 	
-	DeclIntVar::DeclIntVar(NodeRef ident, NodeRef value) :
-	    DeclVar(std::move(ident), std::move(value)) {}
+	DeclIntVar::DeclIntVar(NodeRef ident, NodeRef value, const bool isMutable) :
+	    DeclVar(Kind::DeclIntVar, std::move(ident), std::move(value), isMutable) {}
 
-	DeclBooleanVar::DeclBooleanVar(NodeRef ident, NodeRef value) :
-	    DeclVar(std::move(ident), std::move(value)) {}
+	DeclBooleanVar::DeclBooleanVar(NodeRef ident, NodeRef value, const bool isMutable) :
+	    DeclVar(Kind::DeclBooleanVar, std::move(ident), std::move(value), isMutable) {}
 	
-	DeclFloatVar::DeclFloatVar(NodeRef ident, NodeRef value) :
-	    DeclVar(std::move(ident), std::move(value)) {}
+	DeclFloatVar::DeclFloatVar(NodeRef ident, NodeRef value, const bool isMutable) :
+	    DeclVar(Kind::DeclFloatVar, std::move(ident), std::move(value), isMutable) {}
 	
+	// CONSTANT FOLDING
+
+	static void FoldChild(NodeRef & node, Arena & arena) {
+	    if (auto folded = node->Fold(arena)) {
+		node = std::move(folded);
+	    }
+	}
+
+	// The literal an expression consists of, or null if it isn't
+	// constant.
+	static const Node * GetLiteral(const Node & node) {
+	    if (auto expr = llvm::dyn_cast<Expr>(&node)) {
+		return GetLiteral(expr->GetSubTree());
+	    }
+	    if (llvm::isa<Integer>(node) || llvm::isa<Float>(node) || llvm::isa<Boolean>(node)) {
+		return &node;
+	    }
+	    return nullptr;
+	}
+
+	static NodeRef FoldIntOp(const Node::Kind kind, const int lhs, const int rhs,
+				 Arena & arena) {
+	    // Wrap around, like the instructions CodeGen would emit.
+	    const uint32_t a = lhs, b = rhs;
+	    switch (kind) {
+	    case Node::Kind::AddOp: return arena.Make<Integer>(static_cast<int>(a + b));
+	    case Node::Kind::SubOp: return arena.Make<Integer>(static_cast<int>(a - b));
+	    case Node::Kind::MultOp: return arena.Make<Integer>(static_cast<int>(a * b));
+	    case Node::Kind::DivOp:
+	    case Node::Kind::ModOp:
+		// Undefined at runtime, so leave it to happen there.
+		if (rhs == 0 || (lhs == std::numeric_limits<int>::min() && rhs == -1)) {
+		    return nullptr;
+		}
+		return arena.Make<Integer>(kind == Node::Kind::DivOp ? lhs / rhs : lhs % rhs);
+	    case Node::Kind::EqualityOp: return arena.Make<Boolean>(lhs == rhs);
+	    case Node::Kind::InequalityOp: return arena.Make<Boolean>(lhs != rhs);
+	    default: return nullptr;
+	    }
+	}
+
+	static NodeRef FoldFloatOp(const Node::Kind kind, const float lhs, const float rhs,
+				   Arena & arena) {
+	    switch (kind) {
+	    case Node::Kind::AddOp: return arena.Make<Float>(lhs + rhs);
+	    case Node::Kind::SubOp: return arena.Make<Float>(lhs - rhs);
+	    case Node::Kind::MultOp: return arena.Make<Float>(lhs * rhs);
+	    case Node::Kind::DivOp: return arena.Make<Float>(lhs / rhs);
+	    case Node::Kind::ModOp: return arena.Make<Float>(std::fmod(lhs, rhs));
+	    case Node::Kind::EqualityOp: return arena.Make<Boolean>(lhs == rhs);
+	    // Ordered, like fcmp one: false if either side is NaN.
+	    case Node::Kind::InequalityOp: return arena.Make<Boolean>(lhs < rhs || lhs > rhs);
+	    default: return nullptr;
+	    }
+	}
+
+	NodeRef BinOp::Fold(Arena & arena) {
+	    FoldChild(m_lhs, arena);
+	    FoldChild(m_rhs, arena);
+	    auto lhs = GetLiteral(*m_lhs);
+	    auto rhs = GetLiteral(*m_rhs);
+	    const auto kind = this->GetKind();
+	    if (kind == Kind::LogicalAndOp || kind == Kind::LogicalOrOp) {
+		// Only the left hand side can short circuit the right.
+		if (!lhs) {
+		    return nullptr;
+		}
+		const bool isOr = kind == Kind::LogicalOrOp;
+		if (llvm::cast<Boolean>(lhs)->GetValue() == isOr) {
+		    return arena.Make<Boolean>(isOr);
+		}
+		return std::move(m_rhs);
+	    }
+	    if (!lhs || !rhs) {
+		return nullptr;
+	    }
+	    if (m_resultType == &Type::Int) {
+		return FoldIntOp(kind, llvm::cast<Integer>(lhs)->GetValue(),
+				 llvm::cast<Integer>(rhs)->GetValue(), arena);
+	    } else if (m_resultType == &Type::Float) {
+		return FoldFloatOp(kind, llvm::cast<Float>(lhs)->GetValue(),
+				   llvm::cast<Float>(rhs)->GetValue(), arena);
+	    } else if (m_resultType == &Type::Bool) {
+		const bool a = llvm::cast<Boolean>(lhs)->GetValue();
+		const bool b = llvm::cast<Boolean>(rhs)->GetValue();
+		if (kind == Kind::EqualityOp) {
+		    return arena.Make<Boolean>(a == b);
+		} else if (kind == Kind::InequalityOp) {
+		    return arena.Make<Boolean>(a != b);
+		}
+	    }
+	    return nullptr;
+	}
+
+	NodeRef Call::Fold(Arena & arena) {
+	    for (auto & arg : m_args) {
+		FoldChild(arg, arena);
+	    }
+	    return nullptr;
+	}
+
+	NodeRef Index::Fold(Arena & arena) {
+	    FoldChild(m_index, arena);
+	    return nullptr;
+	}
+
+	NodeRef Assign::Fold(Arena & arena) {
+	    FoldChild(m_value, arena);
+	    return nullptr;
+	}
+
+	NodeRef ElementAssign::Fold(Arena & arena) {
+	    FoldChild(m_index, arena);
+	    FoldChild(m_value, arena);
+	    return nullptr;
+	}
+
+	NodeRef Expr::Fold(Arena & arena) {
+	    FoldChild(m_exprSubTree, arena);
+	    return nullptr;
+	}
+
+	NodeRef Return::Fold(Arena & arena) {
+	    FoldChild(m_value, arena);
+	    return nullptr;
+	}
+
+	NodeRef DeclVar::Fold(Arena & arena) {
+	    FoldChild(m_value, arena);
+	    return nullptr;
+	}
+
+	NodeRef DeclArray::Fold(Arena & arena) {
+	    FoldChild(m_value, arena);
+	    // A length that folds to a positive constant is known at
+	    // compile time, so the array can live in the stack frame. Any
+	    // other length goes on the heap, where a negative one traps.
+	    auto literal = GetLiteral(*m_value);
+	    m_isFixedSize = literal && llvm::isa<Integer>(literal) &&
+		llvm::cast<Integer>(literal)->GetValue() > 0;
+	    return nullptr;
+	}
+
+	NodeRef Function::Fold(Arena & arena) {
+	    this->GetScope().Fold(arena);
+	    return nullptr;
+	}
+
+	// Statements replaced by a Scope, like an if whose branch is known,
+	// are spliced into this one. Anything after a return that comes
+	// out of such a splice is dropped, like the parser does for
+	// statements written after a return.
+	NodeRef Scope::Fold(Arena & arena) {
+	    std::vector<NodeRef> children;
+	    for (auto & child : m_children) {
+		auto folded = child->Fold(arena);
+		if (!folded) {
+		    children.push_back(std::move(child));
+		} else if (auto scope = llvm::dyn_cast<Scope>(folded.get())) {
+		    for (auto & spliced : scope->m_children) {
+			children.push_back(std::move(spliced));
+			if (llvm::isa<Return>(children.back().get())) {
+			    break;
+			}
+		    }
+		} else {
+		    children.push_back(std::move(folded));
+		}
+		if (!children.empty() && llvm::isa<Return>(children.back().get())) {
+		    break;
+		}
+	    }
+	    m_children = arena.MakeArray(std::move(children));
+	    return nullptr;
+	}
+
+	// Branches whose condition is false are removed. The first branch
+	// whose condition is true becomes the else, and everything after it
+	// goes. If no branch is left, the chain is replaced by the body that
+	// always runs, or removed if there is none.
+	NodeRef IfElseChain::Fold(Arena & arena) {
+	    if (m_else) {
+		m_else->Fold(arena);
+	    }
+	    std::vector<Conditional> conditionals;
+	    conditionals.push_back(std::move(m_if));
+	    for (auto & elseif : m_elseifs) {
+		conditionals.push_back(std::move(elseif));
+	    }
+	    m_elseifs = llvm::None;
+	    std::vector<Conditional> live;
+	    for (auto & conditional : conditionals) {
+		FoldChild(conditional.condition, arena);
+		auto literal = GetLiteral(*conditional.condition);
+		if (literal && !llvm::cast<Boolean>(literal)->GetValue()) {
+		    continue;
+		}
+		conditional.GetScope().Fold(arena);
+		if (literal) {
+		    m_else = conditional.TakeScope();
+		    break;
+		}
+		live.push_back(std::move(conditional));
+	    }
+	    if (live.empty()) {
+		if (m_else) {
+		    return std::move(m_else);
+		}
+		return arena.Make<Scope>();
+	    }
+	    m_if = std::move(live.front());
+	    live.erase(live.begin());
+	    m_elseifs = arena.MakeArray(std::move(live));
+	    return nullptr;
+	}
+
+	// A loop with nothing in it has no effect. Its bounds are literals
+	// or variables, so evaluating them has none either.
+	NodeRef ForLoop::Fold(Arena & arena) {
+	    m_decl->Fold(arena);
+	    FoldChild(m_end, arena);
+	    this->GetScope().Fold(arena);
+	    if (this->GetScope().GetChildren().empty()) {
+		return arena.Make<Scope>();
+	    }
+	    return nullptr;
+	}
+
 	// CODE GENERATION
 
 	// I found this helper function in a tutorial from the LLVM site. Creating
 	// a new IRBuilder looks a little suspicious to me, but I read somewhere in
 	// the LLVM mailing list that doing allocations early is a good idea, so I'll
 	// keep using it.
-	template <typename F>
 	static llvm::AllocaInst * CreateEntryBlockAlloca(llvm::Function * fn,
-							 F && cb,
-							 llvm::LLVMContext & context,
-							 const std::string & varName = "") {
+							 llvm::Type * type,
+							 const llvm::Twine & varName = "") {
 	    llvm::IRBuilder<> tempBuilder(&fn->getEntryBlock(),
 					  fn->getEntryBlock().begin());
-	    return tempBuilder.CreateAlloca(cb(context), 0,
-					    varName.c_str());
+	    return tempBuilder.CreateAlloca(type, 0, varName);
+	}
+
+	// Bools are i1 in registers, like the results of compares, but i1
+	// has no size in memory, so they are widened to i8 whenever they
+	// are stored or returned, as clang does for C's bool.
+	static llvm::Value * WidenBool(LLVMState & state, llvm::Value * value) {
+	    if (value->getType()->isIntegerTy(1)) {
+		return state.builder.CreateZExt(value, state.GetLLVMType(Type::Bool));
+	    }
+	    return value;
+	}
+
+	static llvm::Value * NarrowBool(LLVMState & state, llvm::Value * value) {
+	    if (value->getType() == state.GetLLVMType(Type::Bool)) {
+		return state.builder.CreateTrunc(value, state.builder.getInt1Ty());
+	    }
+	    return value;
+	}
+
+	void Node::CodeGenBranch(LLVMState & state, llvm::BasicBlock * trueBlock,
+				 llvm::BasicBlock * falseBlock) {
+	    state.builder.CreateCondBr(this->CodeGen(state), trueBlock, falseBlock);
+	}
+
+	void Expr::CodeGenBranch(LLVMState & state, llvm::BasicBlock * trueBlock,
+				 llvm::BasicBlock * falseBlock) {
+	    m_exprSubTree->CodeGenBranch(state, trueBlock, falseBlock);
 	}
 
 	llvm::Value * MultOp::CodeGen(LLVMState & state) {
 	    auto lhs = m_lhs->CodeGen(state);
 	    auto rhs = m_rhs->CodeGen(state);
-	    if (m_resultType == "int") {
+	    if (m_resultType == &Type::Int) {
 		return state.builder.CreateMul(lhs, rhs);
-	    } else if (m_resultType == "float") {
+	    } else if (m_resultType == &Type::Float) {
 		return state.builder.CreateFMul(lhs, rhs);
 	    } else {
 		throw std::runtime_error("type cannot be multiplied");
@@ -91,9 +358,9 @@ namespace coralc {
 	llvm::Value * DivOp::CodeGen(LLVMState & state) {
 	    auto lhs = m_lhs->CodeGen(state);
 	    auto rhs = m_rhs->CodeGen(state);
-	    if (m_resultType == "int") {
+	    if (m_resultType == &Type::Int) {
 		return state.builder.CreateSDiv(lhs, rhs);
-	    } else if (m_resultType == "float") {
+	    } else if (m_resultType == &Type::Float) {
 		return state.builder.CreateFDiv(lhs, rhs);
 	    } else {
 		throw std::runtime_error("type cannot be divided");
@@ -107,68 +374,92 @@ namespace coralc {
 	    auto lhs = m_lhs->CodeGen(state);
 	    auto rhs = m_rhs->CodeGen(state);
 	    llvm::Value * ret = nullptr;
-	    if (m_resultType == "int") {
+	    if (m_resultType == &Type::Int) {
 		ret = state.builder.CreateICmpNE(lhs, rhs, equalityTag);
-	    } else if (m_resultType == "float") {
+	    } else if (m_resultType == &Type::Float) {
 		ret = state.builder.CreateFCmpONE(lhs, rhs, equalityTag);
-	    } else if (m_resultType == "bool") {
+	    } else if (m_resultType == &Type::Bool) {
 		ret = state.builder.CreateICmpNE(lhs, rhs, equalityTag);
 	    } else {
 		throw std::runtime_error("type cannot be compared");
 	    }
-	    return state.builder.CreateIntCast(ret, llvm::Type::getInt8Ty(state.context), true);
+	    return ret;
 	}
 
 	llvm::Value * EqualityOp::CodeGen(LLVMState & state) {
 	    auto lhs = m_lhs->CodeGen(state);
 	    auto rhs = m_rhs->CodeGen(state);
 	    llvm::Value * ret = nullptr;
-	    if (m_resultType == "int") {
+	    if (m_resultType == &Type::Int) {
 		ret = state.builder.CreateICmpEQ(lhs, rhs, equalityTag);
-	    } else if (m_resultType == "float") {
+	    } else if (m_resultType == &Type::Float) {
 	        ret = state.builder.CreateFCmpOEQ(lhs, rhs, equalityTag);
-	    } else if (m_resultType == "bool") {
+	    } else if (m_resultType == &Type::Bool) {
 	        ret = state.builder.CreateICmpEQ(lhs, rhs, equalityTag);
 	    } else {
 		throw std::runtime_error("type cannot be compared");
 	    }
-	    // I've had trouble with the llvm assembler and single bit bools,
-	    // so I've been casting them to 8 bit integers.
-	    return state.builder.CreateIntCast(ret, llvm::Type::getInt8Ty(state.context), true);
+	    return ret;
+	}
+
+	// and/or only evaluate their right hand side when the left hand
+	// side doesn't already decide the result. As a value, the result
+	// is a phi of the short circuited constant and the right hand side.
+	static llvm::Value * CodeGenShortCircuit(LLVMState & state, Node & lhs, Node & rhs,
+						 const bool isAnd) {
+	    auto fn = state.builder.GetInsertBlock()->getParent();
+	    auto rhsBlock = llvm::BasicBlock::Create(state.context, isAnd ? "andrhs" : "orrhs", fn);
+	    auto endBlock = llvm::BasicBlock::Create(state.context, isAnd ? "andend" : "orend", fn);
+	    auto lhsValue = lhs.CodeGen(state);
+	    auto lhsBlock = state.builder.GetInsertBlock();
+	    if (isAnd) {
+		state.builder.CreateCondBr(lhsValue, rhsBlock, endBlock);
+	    } else {
+		state.builder.CreateCondBr(lhsValue, endBlock, rhsBlock);
+	    }
+	    state.builder.SetInsertPoint(rhsBlock);
+	    auto rhsValue = rhs.CodeGen(state);
+	    rhsBlock = state.builder.GetInsertBlock();
+	    state.builder.CreateBr(endBlock);
+	    state.builder.SetInsertPoint(endBlock);
+	    auto result = state.builder.CreatePHI(state.builder.getInt1Ty(), 2);
+	    result->addIncoming(state.builder.getInt1(!isAnd), lhsBlock);
+	    result->addIncoming(rhsValue, rhsBlock);
+	    return result;
 	}
 
 	llvm::Value * LogicalAndOp::CodeGen(LLVMState & state) {
-	    auto lhs = m_lhs->CodeGen(state);
-	    auto rhs = m_rhs->CodeGen(state);
-	    // Note: I use 255 and not 1 as boolean true. This is because I cast comparison
-	    // results to eight bit signed, see above comment.
-	    auto boolTrue = llvm::ConstantInt::get(state.context, llvm::APInt(8, 255));
-	    auto isLhsTrue =
-		state.builder.CreateICmpEQ(lhs, boolTrue);
-	    auto isRhsTrue =
-		state.builder.CreateICmpEQ(rhs, boolTrue);
-	    auto bothTrue = state.builder.CreateAnd(isLhsTrue, isRhsTrue);
-	    return state.builder.CreateIntCast(bothTrue, llvm::Type::getInt8Ty(state.context), true);
+	    return CodeGenShortCircuit(state, *m_lhs, *m_rhs, true);
+	}
+
+	void LogicalAndOp::CodeGenBranch(LLVMState & state, llvm::BasicBlock * trueBlock,
+					 llvm::BasicBlock * falseBlock) {
+	    auto fn = state.builder.GetInsertBlock()->getParent();
+	    auto rhsBlock = llvm::BasicBlock::Create(state.context, "andrhs", fn);
+	    m_lhs->CodeGenBranch(state, rhsBlock, falseBlock);
+	    state.builder.SetInsertPoint(rhsBlock);
+	    m_rhs->CodeGenBranch(state, trueBlock, falseBlock);
 	}
 
 	llvm::Value * LogicalOrOp::CodeGen(LLVMState & state) {
-	    auto lhs = m_lhs->CodeGen(state);
-	    auto rhs = m_rhs->CodeGen(state);
-	    auto boolTrue = llvm::ConstantInt::get(state.context, llvm::APInt(8, 255));
-	    auto isLhsTrue =
-		state.builder.CreateICmpEQ(lhs, boolTrue);
-	    auto isRhsTrue =
-		state.builder.CreateICmpEQ(rhs, boolTrue);
-	    auto eitherTrue = state.builder.CreateOr(isLhsTrue, isRhsTrue);
-	    return state.builder.CreateIntCast(eitherTrue, llvm::Type::getInt8Ty(state.context), true);
+	    return CodeGenShortCircuit(state, *m_lhs, *m_rhs, false);
+	}
+
+	void LogicalOrOp::CodeGenBranch(LLVMState & state, llvm::BasicBlock * trueBlock,
+					llvm::BasicBlock * falseBlock) {
+	    auto fn = state.builder.GetInsertBlock()->getParent();
+	    auto rhsBlock = llvm::BasicBlock::Create(state.context, "orrhs", fn);
+	    m_lhs->CodeGenBranch(state, trueBlock, rhsBlock);
+	    state.builder.SetInsertPoint(rhsBlock);
+	    m_rhs->CodeGenBranch(state, trueBlock, falseBlock);
 	}
 
 	llvm::Value * AddOp::CodeGen(LLVMState & state) {
 	    auto lhs = m_lhs->CodeGen(state);
 	    auto rhs = m_rhs->CodeGen(state);
-	    if (m_resultType == "int") {
+	    if (m_resultType == &Type::Int) {
 		return state.builder.CreateAdd(lhs, rhs);
-	    } else if (m_resultType == "float") {
+	    } else if (m_resultType == &Type::Float) {
 		return state.builder.CreateFAdd(lhs, rhs);
 	    } else {
 		throw std::runtime_error("type cannot be added");
@@ -179,9 +470,9 @@ namespace coralc {
 	llvm::Value * ModOp::CodeGen(LLVMState & state) {
 	    auto lhs = m_lhs->CodeGen(state);
 	    auto rhs = m_rhs->CodeGen(state);
-	    if (m_resultType == "int") {
+	    if (m_resultType == &Type::Int) {
 		return state.builder.CreateSRem(lhs, rhs);
-	    } else if (m_resultType == "float") {
+	    } else if (m_resultType == &Type::Float) {
 		return state.builder.CreateFRem(lhs, rhs);
 	    } else {
 		throw std::runtime_error("__Internal: unexpected type in mod op");
@@ -191,9 +482,9 @@ namespace coralc {
 	llvm::Value * SubOp::CodeGen(LLVMState & state) {
 	    auto lhs = m_lhs->CodeGen(state);
 	    auto rhs = m_rhs->CodeGen(state);
-	    if (m_resultType == "int") {
+	    if (m_resultType == &Type::Int) {
 		return state.builder.CreateSub(lhs, rhs);
-	    } else if (m_resultType == "float") {
+	    } else if (m_resultType == &Type::Float) {
 		return state.builder.CreateFSub(lhs, rhs);
 	    } else {
 		throw std::runtime_error("type cannot be subtracted");
@@ -206,87 +497,269 @@ namespace coralc {
 	}
 
 	llvm::Value * Ident::CodeGen(LLVMState & state) {
+	    auto bound = state.values.find(m_name);
+	    if (bound != state.values.end()) {
+		return bound->second;
+	    }
 	    llvm::Value * value = state.vars[m_name];
-	    return state.builder.CreateLoad(value, m_name.c_str());
+	    return NarrowBool(state, state.builder.CreateLoad(value, m_name));
 	}
 
 	llvm::Value * Expr::CodeGen(LLVMState & state) {
 	    return m_exprSubTree->CodeGen(state);
 	}
 	
-	llvm::Value * DeclIntVar::CodeGen(LLVMState & state) {
-	    const auto & varName = dynamic_cast<Ident &>(*m_ident).GetName();
+	llvm::Value * DeclVar::Bind(LLVMState & state, const Type & type) {
+	    const auto varName = this->GetIdentName();
+	    auto value = m_value->CodeGen(state);
+	    if (!m_isMutable) {
+		if (llvm::isa<llvm::Instruction>(value) && !value->hasName()) {
+		    value->setName(varName);
+		}
+		state.values[varName] = value;
+		return value;
+	    }
 	    auto fn = state.builder.GetInsertBlock()->getParent();
-	    auto alloca = CreateEntryBlockAlloca(fn, llvm::Type::getInt32Ty,
-						 state.context, varName);
-	    state.builder.CreateStore(m_value->CodeGen(state), alloca);
+	    auto alloca = CreateEntryBlockAlloca(fn, state.GetLLVMType(type), varName);
+	    state.builder.CreateStore(WidenBool(state, value), alloca);
 	    state.vars[varName] = alloca;
-	    return state.vars[varName];
+	    return alloca;
+	}
+
+	llvm::Value * DeclIntVar::CodeGen(LLVMState & state) {
+	    return this->Bind(state, Type::Int);
 	}
 
 	llvm::Value * DeclFloatVar::CodeGen(LLVMState & state) {
-	    const auto & varName = dynamic_cast<Ident &>(*m_ident).GetName();
-	    auto fn = state.builder.GetInsertBlock()->getParent();
-	    auto alloca = CreateEntryBlockAlloca(fn, llvm::Type::getFloatTy,
-						 state.context, varName);
-	    state.builder.CreateStore(m_value->CodeGen(state), alloca);
-	    state.vars[varName] = alloca;
-	    return state.vars[varName];
+	    return this->Bind(state, Type::Float);
 	}
 
 	llvm::Value * DeclBooleanVar::CodeGen(LLVMState & state) {
-	    const auto & varName = dynamic_cast<Ident &>(*m_ident).GetName();
-	    auto fn = state.builder.GetInsertBlock()->getParent();
-	    auto alloca = CreateEntryBlockAlloca(fn, llvm::Type::getInt8Ty,
-						 state.context, varName);
-	    state.builder.CreateStore(m_value->CodeGen(state), alloca);
-	    state.vars[varName] = alloca;
-	    return state.vars[varName];
+	    return this->Bind(state, Type::Bool);
 	}
 	
+	static llvm::BasicBlock * GetTrapBlock(LLVMState & state) {
+	    auto & fnInfo = state.currentFnInfo;
+	    if (!fnInfo.trapBlock) {
+		auto fn = state.builder.GetInsertBlock()->getParent();
+		fnInfo.trapBlock = llvm::BasicBlock::Create(state.context, "trap", fn);
+		llvm::IRBuilder<> trapBuilder(fnInfo.trapBlock);
+		trapBuilder.CreateCall(llvm::Intrinsic::getDeclaration(state.modRef.get(),
+								       llvm::Intrinsic::trap));
+		trapBuilder.CreateUnreachable();
+	    }
+	    return fnInfo.trapBlock;
+	}
+
+	// Out of bounds accesses trap, unless the index is known to be in
+	// bounds (see LLVMState::inBounds) or the check folds away.
+	static llvm::Value * GetElementPointer(LLVMState & state, const ArrayInfo & array,
+					       llvm::Value * index) {
+	    if (!state.inBounds.count({index, array.length})) {
+		// Unsigned, so that negative indices fail too.
+		auto inBounds = state.builder.CreateICmpULT(index, array.length, "inbounds");
+		auto constant = llvm::dyn_cast<llvm::Constant>(inBounds);
+		if (!constant || !constant->isOneValue()) {
+		    auto fn = state.builder.GetInsertBlock()->getParent();
+		    auto next = llvm::BasicBlock::Create(state.context, "inbounds", fn);
+		    state.builder.CreateCondBr(inBounds, next, GetTrapBlock(state));
+		    state.builder.SetInsertPoint(next);
+		}
+	    }
+	    return state.builder.CreateInBoundsGEP(array.data, index);
+	}
+
+	llvm::Value * Index::CodeGen(LLVMState & state) {
+	    const auto & array = state.arrays.at(m_name);
+	    auto ptr = GetElementPointer(state, array, m_index->CodeGen(state));
+	    return NarrowBool(state, state.builder.CreateLoad(ptr, m_name));
+	}
+
+	llvm::Value * Assign::CodeGen(LLVMState & state) {
+	    state.builder.CreateStore(WidenBool(state, m_value->CodeGen(state)),
+				      state.vars.at(m_name));
+	    return nullptr;
+	}
+
+	llvm::Value * ElementAssign::CodeGen(LLVMState & state) {
+	    const auto & array = state.arrays.at(m_name);
+	    auto ptr = GetElementPointer(state, array, m_index->CodeGen(state));
+	    state.builder.CreateStore(WidenBool(state, m_value->CodeGen(state)), ptr);
+	    return nullptr;
+	}
+
+	llvm::Value * DeclArray::CodeGen(LLVMState & state) {
+	    const auto varName = this->GetIdentName();
+	    auto & module = *state.modRef;
+	    auto fn = state.builder.GetInsertBlock()->getParent();
+	    auto elementType = state.GetLLVMType(*m_elementType);
+	    const auto & dataLayout = module.getDataLayout();
+	    const uint64_t elementSize = dataLayout.getTypeAllocSize(elementType);
+	    auto length = m_value->CodeGen(state);
+	    llvm::Value * data = nullptr;
+	    if (m_isFixedSize) {
+		const uint64_t count = llvm::cast<llvm::ConstantInt>(length)->getZExtValue();
+		auto storageType = llvm::ArrayType::get(elementType, count);
+		auto storage = CreateEntryBlockAlloca(fn, storageType, varName);
+		data = state.builder.CreateConstInBoundsGEP2_32(storageType, storage, 0, 0);
+		// Zeroed where it is declared, so that a declaration in a
+		// loop gives a fresh array every iteration.
+		state.builder.CreateMemSet(data, state.builder.getInt8(0), count * elementSize,
+					   dataLayout.getABITypeAlignment(elementType));
+	    } else {
+		auto negative = state.builder.CreateICmpSLT(length, state.builder.getInt32(0));
+		auto next = llvm::BasicBlock::Create(state.context, "alloc", fn);
+		state.builder.CreateCondBr(negative, GetTrapBlock(state), next);
+		state.builder.SetInsertPoint(next);
+		auto sizeType = dataLayout.getIntPtrType(state.context);
+		auto calloc = module.getOrInsertFunction(
+		    "calloc", llvm::FunctionType::get(state.builder.getInt8PtrTy(),
+						      {sizeType, sizeType}, false));
+		auto memory = state.builder.CreateCall(
+		    calloc, {state.builder.CreateZExt(length, sizeType),
+			     llvm::ConstantInt::get(sizeType, elementSize)});
+		// Out of memory, unless the array is empty: calloc may
+		// return null for zero bytes.
+		auto failed = state.builder.CreateAnd(
+		    state.builder.CreateIsNull(memory),
+		    state.builder.CreateICmpNE(length, state.builder.getInt32(0)));
+		next = llvm::BasicBlock::Create(state.context, "allocated", fn);
+		state.builder.CreateCondBr(failed, GetTrapBlock(state), next);
+		state.builder.SetInsertPoint(next);
+		state.heapArrays.back().push_back(memory);
+		data = state.builder.CreatePointerCast(memory, elementType->getPointerTo());
+	    }
+	    data->setName(varName);
+	    state.arrays[varName] = {data, length};
+	    return data;
+	}
+
+	// Frees the heap arrays of the innermost scopes, down to and
+	// including the one at index first.
+	static void FreeHeapArrays(LLVMState & state, const size_t first) {
+	    llvm::Constant * free = nullptr;
+	    for (size_t i = first; i < state.heapArrays.size(); ++i) {
+		for (auto memory : state.heapArrays[i]) {
+		    if (!free) {
+			free = state.modRef->getOrInsertFunction(
+			    "free", llvm::FunctionType::get(state.builder.getVoidTy(),
+							    {state.builder.getInt8PtrTy()}, false));
+		    }
+		    state.builder.CreateCall(free, {memory});
+		}
+	    }
+	}
+
+	static llvm::FunctionType * GetFunctionType(LLVMState & state, const Type & returnType,
+						    llvm::ArrayRef<const Type *> paramTypes) {
+	    std::vector<llvm::Type *> params;
+	    for (auto type : paramTypes) {
+		params.push_back(state.GetLLVMType(*type));
+	    }
+	    return llvm::FunctionType::get(state.GetLLVMType(returnType), params, false);
+	}
+
+	// The name of a function's internal definition, when it has one.
+	static std::string GetImplName(llvm::StringRef name) {
+	    return name.str() + ".impl";
+	}
+
+	// Callers in the same module call the internal definition with
+	// fastcc. Callers lowered into another module, such as another
+	// partition, can only see the C compatible export.
+	llvm::Value * Call::CodeGen(LLVMState & state) {
+	    std::vector<llvm::Value *> args;
+	    for (auto & arg : m_args) {
+		args.push_back(WidenBool(state, arg->CodeGen(state)));
+	    }
+	    auto & module = *state.modRef;
+	    llvm::CallInst * call = nullptr;
+	    if (auto impl = module.getFunction(GetImplName(m_name))) {
+		call = state.builder.CreateCall(impl, args);
+		call->setCallingConv(impl->getCallingConv());
+	    } else {
+		auto type = GetFunctionType(state, *m_returnType, m_paramTypes);
+		auto callee = module.getOrInsertFunction(m_name, type);
+		call = state.builder.CreateCall(callee, args);
+	    }
+	    return NarrowBool(state, call);
+	}
+
+	// Exports an internal definition under the function's own name,
+	// with the C calling convention, for code outside the file.
+	static void CreateThunk(LLVMState & state, llvm::Function * impl,
+				llvm::StringRef name) {
+	    auto thunk = llvm::Function::Create(impl->getFunctionType(),
+						llvm::Function::ExternalLinkage,
+						name, state.modRef.get());
+	    auto entry = llvm::BasicBlock::Create(state.context, "entrypoint", thunk);
+	    state.builder.SetInsertPoint(entry);
+	    std::vector<llvm::Value *> args;
+	    for (auto & arg : thunk->args()) {
+		args.push_back(&arg);
+	    }
+	    auto call = state.builder.CreateCall(impl, args);
+	    call->setCallingConv(impl->getCallingConv());
+	    call->setTailCall();
+	    if (thunk->getReturnType()->isVoidTy()) {
+		state.builder.CreateRetVoid();
+	    } else {
+		state.builder.CreateRet(call);
+	    }
+	}
+
 	llvm::Value * Function::CodeGen(LLVMState & state) {
-	    llvm::FunctionType * funcType = nullptr;
-	    if (m_returnType == "void") {
-		state.currentFnInfo.exitValue = nullptr;
-		funcType = llvm::FunctionType::get(state.builder.getVoidTy(), false);
-	    } else if (m_returnType == "int") {
-		funcType = llvm::FunctionType::get(state.builder.getInt32Ty(), false);
-	    } else if (m_returnType == "float") {
-		funcType = llvm::FunctionType::get(state.builder.getFloatTy(), false);
-	    } else if (m_returnType == "bool") {
-		funcType = llvm::FunctionType::get(state.builder.getInt8Ty(), false);
+	    std::vector<const Type *> paramTypes;
+	    for (auto & param : m_params) {
+		paramTypes.push_back(param.type);
+	    }
+	    auto funcType = GetFunctionType(state, *m_returnType, paramTypes);
+	    llvm::Function * funct = nullptr;
+	    if (m_isCalled) {
+		funct = llvm::Function::Create(funcType, llvm::Function::InternalLinkage,
+					       GetImplName(m_name), state.modRef.get());
+		funct->setCallingConv(llvm::CallingConv::Fast);
 	    } else {
-		throw std::runtime_error("functions of " + m_returnType + "are not supported");
+		funct = llvm::Function::Create(funcType, llvm::Function::ExternalLinkage,
+					       m_name, state.modRef.get());
 	    }
-	    auto funct = llvm::Function::Create(funcType, llvm::Function::ExternalLinkage,
-						m_name, state.modRef.get());
 	    auto fnEntry = llvm::BasicBlock::Create(state.context, "entrypoint", funct);
 	    auto fnExit = llvm::BasicBlock::Create(state.context, "exitpoint", funct);
 	    state.currentFnInfo.exitPoint = fnExit;
+	    state.currentFnInfo.trapBlock = nullptr;
+	    // Names are only unique within a function.
+	    state.vars.clear();
+	    state.values.clear();
+	    state.arrays.clear();
+	    state.inBounds.clear();
 	    state.builder.SetInsertPoint(fnEntry);
+	    // Parameters are immutable, so they are bound like var.
+	    auto arg = funct->arg_begin();
+	    for (auto & param : m_params) {
+		arg->setName(param.name);
+		state.values[param.name] = NarrowBool(state, &*arg);
+		++arg;
+	    }
 	    static const std::string exitVarName = "exitcode";
-	    if (m_returnType == "int") {
-		state.currentFnInfo.exitValue =
-		    CreateEntryBlockAlloca(funct, llvm::Type::getInt32Ty, state.context,
-					   exitVarName);
-	    } else if (m_returnType == "float") {
-		state.currentFnInfo.exitValue =
-		    CreateEntryBlockAlloca(funct, llvm::Type::getFloatTy, state.context,
-					   exitVarName);
-	    } else if (m_returnType == "bool") {
+	    if (m_returnType == &Type::Void) {
+		state.currentFnInfo.exitValue = nullptr;
+	    } else {
 		state.currentFnInfo.exitValue =
-		    CreateEntryBlockAlloca(funct, llvm::Type::getInt8Ty, state.context,
+		    CreateEntryBlockAlloca(funct, state.GetLLVMType(*m_returnType),
 					   exitVarName);
 	    }
 	    this->GetScope().CodeGen(state);
 	    state.builder.SetInsertPoint(fnExit);
-	    if (m_returnType == "void") {
+	    if (m_returnType == &Type::Void) {
 		state.builder.CreateRetVoid();
-	    } else if (m_returnType == "int" || m_returnType == "float" || m_returnType == "bool") {
+	    } else {
 		auto exitValue = state.builder.CreateLoad(state.currentFnInfo.exitValue,
 							  exitVarName);
 		state.builder.CreateRet(exitValue);
 	    }
+	    if (m_isCalled) {
+		CreateThunk(state, funct, m_name);
+	    }
 	    return nullptr;
 	}
 
@@ -310,18 +783,17 @@ namespace coralc {
 	    if (m_else) {
 		elseBody = llvm::BasicBlock::Create(state.context, "elsebody", fn);
 		state.builder.SetInsertPoint(elseBody);
+		state.stack.push(afterBlock);
 		m_else->CodeGen(state);
-		state.builder.CreateBr(afterBlock);
+		state.stack.pop();
 	    }
 	    state.builder.SetInsertPoint(headerBlock);
-	    auto ifCond = state.builder.CreateIntCast(m_if.condition->CodeGen(state),
-						      llvm::Type::getInt1Ty(state.context), true);
 	    if (elseifBlocks.size() > 0) { 
-		state.builder.CreateCondBr(ifCond, ifBlock, elseifBlocks[0].condBlock);
+		m_if.condition->CodeGenBranch(state, ifBlock, elseifBlocks[0].condBlock);
 	    } else if (m_else) {
-		state.builder.CreateCondBr(ifCond, ifBlock, elseBody);
+		m_if.condition->CodeGenBranch(state, ifBlock, elseBody);
 	    } else {
-		state.builder.CreateCondBr(ifCond, ifBlock, afterBlock);
+		m_if.condition->CodeGenBranch(state, ifBlock, afterBlock);
 	    }
 	    state.builder.SetInsertPoint(ifBlock);
 	    state.stack.push(afterBlock);
@@ -329,17 +801,16 @@ namespace coralc {
 	    state.stack.pop();
 	    for (size_t i = 0; i < elseifBlocks.size(); ++i) {
 		state.builder.SetInsertPoint(elseifBlocks[i].condBlock);
-		auto elseifCond = state.builder.CreateIntCast(m_elseifs[i].condition->CodeGen(state),
-							      llvm::Type::getInt1Ty(state.context), true);
+		auto & elseifCond = *m_elseifs[i].condition;
 		if (i == elseifBlocks.size() - 1) {
 		    if (m_else) {
-			state.builder.CreateCondBr(elseifCond, elseifBlocks[i].bodyBlock, elseBody);
+			elseifCond.CodeGenBranch(state, elseifBlocks[i].bodyBlock, elseBody);
 		    } else {
-			state.builder.CreateCondBr(elseifCond, elseifBlocks[i].bodyBlock, afterBlock);
+			elseifCond.CodeGenBranch(state, elseifBlocks[i].bodyBlock, afterBlock);
 		    }
 		} else {
-		    state.builder.CreateCondBr(elseifCond, elseifBlocks[i].bodyBlock,
-					       elseifBlocks[i + 1].condBlock);
+		    elseifCond.CodeGenBranch(state, elseifBlocks[i].bodyBlock,
+					     elseifBlocks[i + 1].condBlock);
 		}
 		state.builder.SetInsertPoint(elseifBlocks[i].bodyBlock);
 		state.stack.push(afterBlock);
@@ -350,34 +821,63 @@ namespace coralc {
 	    return llvm::Constant::getNullValue(llvm::Type::getInt32Ty(state.context));
 	}
 
+	// Emits the loop in the form LLVM's loop passes recognize: the
+	// bounds are evaluated once in the preheader, a guard skips empty
+	// ranges, the induction variable is a phi in the header and the
+	// latch exits with a signed compare against the hoisted bound.
+	// a..b counts up from a to b - 1, reverse a..b counts down from
+	// b - 1 to a. The parser hands reverse loops over with the bounds
+	// swapped, so m_decl holds b and m_end holds a.
 	llvm::Value * ForLoop::CodeGen(LLVMState & state) {
 	    auto fn = state.builder.GetInsertBlock()->getParent();
-	    m_decl->CodeGen(state);
-	    auto & varName = this->GetIdentName();
-	    auto alloca = state.vars[varName];
-	    auto loopBlock = llvm::BasicBlock::Create(state.context, "loop", fn);
+	    const auto varName = this->GetIdentName();
+	    auto stepVal = llvm::ConstantInt::get(state.context, llvm::APInt(32, 1));
+	    auto startVal = llvm::cast<DeclIntVar>(*m_decl).GetValue().CodeGen(state);
+	    auto endVal = m_end->CodeGen(state);
+	    auto lowerVal = m_isReverse ? endVal : startVal;
+	    auto upperVal = m_isReverse ? startVal : endVal;
+	    // Both directions are guarded with the original bounds, and
+	    // every step stays within them, so no add or sub can overflow
+	    // even when a bound is INT_MIN or INT_MAX.
+	    auto guardCond = state.builder.CreateICmpSLT(lowerVal, upperVal, "guard");
+	    auto preheader = state.builder.GetInsertBlock();
 	    auto loopBody = llvm::BasicBlock::Create(state.context, "loopbody", fn);
+	    auto loopBlock = llvm::BasicBlock::Create(state.context, "loop", fn);
 	    auto afterBlock = llvm::BasicBlock::Create(state.context, "afterloop", fn);
-	    state.builder.CreateBr(loopBody);
+	    state.builder.CreateCondBr(guardCond, loopBody, afterBlock);
 	    state.builder.SetInsertPoint(loopBody);
+	    // A reverse loop's phi holds one above the loop variable. The
+	    // variable is decremented at the top of the body, where the phi
+	    // is still above the lower bound.
+	    auto phi = state.builder.CreatePHI(state.GetLLVMType(Type::Int), 2,
+					       varName + (m_isReverse ? ".above" : ""));
+	    phi->addIncoming(startVal, preheader);
+	    llvm::Value * currVar = phi;
+	    if (m_isReverse) {
+		currVar = state.builder.CreateNSWSub(phi, stepVal, varName);
+	    }
+	    state.values[varName] = currVar;
+	    auto lowerConst = llvm::dyn_cast<llvm::ConstantInt>(lowerVal);
+	    if (lowerConst && !lowerConst->isNegative()) {
+		state.inBounds.insert({currVar, upperVal});
+	    }
 	    state.stack.push(loopBlock);
 	    this->GetScope().CodeGen(state);
 	    state.stack.pop();
 	    state.builder.SetInsertPoint(loopBlock);
-	    auto stepVal = llvm::ConstantInt::get(state.context, llvm::APInt(32, 1));
-	    auto endCond = state.builder.CreateSub(m_end->CodeGen(state), stepVal);
-	    auto currVar = state.builder.CreateLoad(alloca, varName.c_str());
 	    llvm::Value * nextVar = nullptr;
+	    llvm::Value * loopCond = nullptr;
 	    if (m_isReverse) {
-		nextVar = state.builder.CreateSub(currVar, stepVal, "nextvar");
+		nextVar = currVar;
+		loopCond = state.builder.CreateICmpSGT(currVar, endVal, "loopcond");
 	    } else {
-		nextVar = state.builder.CreateAdd(currVar, stepVal, "nextvar");
+		nextVar = state.builder.CreateNSWAdd(currVar, stepVal, "nextvar");
+		loopCond = state.builder.CreateICmpSLT(nextVar, endVal, "loopcond");
 	    }
-	    state.builder.CreateStore(nextVar, alloca);
-	    endCond = state.builder.CreateICmpNE(endCond, nextVar, "loopcond");
-	    state.builder.CreateCondBr(endCond, loopBody, afterBlock);
+	    phi->addIncoming(nextVar, loopBlock);
+	    state.builder.CreateCondBr(loopCond, loopBody, afterBlock);
 	    state.builder.SetInsertPoint(afterBlock);
-	    state.vars.erase(varName);
+	    state.values.erase(varName);
 	    return llvm::Constant::getNullValue(llvm::Type::getInt32Ty(state.context));
 	}
 
@@ -387,14 +887,18 @@ namespace coralc {
 	
 	llvm::Value * Scope::CodeGen(LLVMState & state) {
 	    bool foundRet = false;
+	    state.heapArrays.emplace_back();
 	    for (auto & child : m_children) {
-		Return * ret = dynamic_cast<Return *>(child.get());
+		auto ret = llvm::dyn_cast<Return>(child.get());
 		if (ret) {
 		    // The parser does not generate nodes for statements after
 		    // a return, so it's safe to assume here that encountering
 		    // a return means the end of a BB
+		    auto value = ret->CodeGen(state);
+		    // A return leaves every scope of the function.
+		    FreeHeapArrays(state, 0);
 		    if (state.currentFnInfo.exitValue) {
-			state.builder.CreateStore(ret->CodeGen(state),
+			state.builder.CreateStore(WidenBool(state, value),
 						  state.currentFnInfo.exitValue);
 		    }
 		    state.builder.CreateBr(state.currentFnInfo.exitPoint);
@@ -404,8 +908,10 @@ namespace coralc {
 		}
 	    }
 	    if (!state.stack.empty() && !foundRet) {
+		FreeHeapArrays(state, state.heapArrays.size() - 1);
 		state.builder.CreateBr(state.stack.top());
 	    }
+	    state.heapArrays.pop_back();
 	    return nullptr;
 	}
 
@@ -415,7 +921,7 @@ namespace coralc {
 	}
 
 	llvm::Value * Boolean::CodeGen(LLVMState & state) {
-	    return llvm::ConstantInt::get(state.context, llvm::APInt(8, m_value));
+	    return state.builder.getInt1(m_value);
 	}
 
 	llvm::Value * Float::CodeGen(LLVMState & state) {
@@ -1,5 +1,11 @@
 #pragma once
 
+#include <array>
+#include <map>
+#include <set>
+#include <stack>
+#include <type_traits>
+#include <vector>
 #include <iostream>
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
@@ -14,15 +20,24 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Type.h"
+#include "llvm/Support/Allocator.h"
 #include "llvm/Support/Casting.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Bitcode/ReaderWriter.h"
+#include "Type.hpp"
 
 namespace coralc {
     struct FunctionInfo {
 	llvm::AllocaInst * exitValue = nullptr;
 	llvm::BasicBlock * exitPoint = nullptr;
+	// Where failed bounds checks branch to. Created on first use.
+	llvm::BasicBlock * trapBlock = nullptr;
+    };
+    struct ArrayInfo {
+	// Points to the first element.
+	llvm::Value * data;
+	llvm::Value * length;
     };
     struct LLVMState {
 	llvm::LLVMContext context;
@@ -30,33 +45,211 @@ namespace coralc {
 	std::unique_ptr<llvm::Module> modRef;
 	std::stack<llvm::BasicBlock *> stack;
 	FunctionInfo currentFnInfo;
-	std::map<std::string, llvm::AllocaInst *> vars;
+	// Stack slots of mutable variables. Everything else, immutable
+	// variables and loop counters, is bound directly to its value.
+	std::map<llvm::StringRef, llvm::AllocaInst *> vars;
+	std::map<llvm::StringRef, llvm::Value *> values;
+	std::map<llvm::StringRef, ArrayInfo> arrays;
+	// Pairs of an index and a length that the index is known to be
+	// less than, and not negative. Accesses to arrays of that length
+	// at that index need no bounds check. Loops record their counter
+	// here; since immutable variables are SSA values, a loop over
+	// 0..n matches an array allocated with length n.
+	std::set<std::pair<llvm::Value *, llvm::Value *>> inBounds;
+	// Heap arrays allocated by each enclosing scope, innermost last,
+	// which are freed when the scope is left.
+	std::vector<std::vector<llvm::Value *>> heapArrays;
+	std::array<llvm::Type *, Type::count> types;
 	LLVMState() : builder(context),
-		      modRef(std::make_unique<llvm::Module>("top", context)) {}
+		      modRef(std::make_unique<llvm::Module>("top", context)) {
+	    types[Type::Void.GetId()] = builder.getVoidTy();
+	    types[Type::Int.GetId()] = builder.getInt32Ty();
+	    types[Type::Float.GetId()] = builder.getFloatTy();
+	    // The type of bools in memory and in function signatures. In
+	    // registers they are i1, see WidenBool in ast.cpp.
+	    types[Type::Bool.GetId()] = builder.getInt8Ty();
+	    // Pointers to the first element.
+	    types[Type::IntArray.GetId()] = types[Type::Int.GetId()]->getPointerTo();
+	    types[Type::FloatArray.GetId()] = types[Type::Float.GetId()]->getPointerTo();
+	    types[Type::BoolArray.GetId()] = types[Type::Bool.GetId()]->getPointerTo();
+	}
+	llvm::Type * GetLLVMType(const Type & type) const {
+	    return types[type.GetId()];
+	}
     };
     
     namespace ast {
 	class Node;
+
+	// Owns a node in an Arena the way unique_ptr would, except that
+	// nothing happens when it goes away. Nodes are never destroyed:
+	// they, and the names and child arrays they point to, are freed
+	// all at once with the arena, without walking the tree. So this
+	// has no destructor, which keeps the nodes holding it trivially
+	// destructible.
+	template <typename T>
+	class ArenaRef {
+	    T * m_node;
+	public:
+	    ArenaRef(std::nullptr_t = nullptr) : m_node(nullptr) {}
+	    explicit ArenaRef(T * node) : m_node(node) {}
+	    ArenaRef(ArenaRef && other) : m_node(other.release()) {}
+	    template <typename U>
+	    ArenaRef(ArenaRef<U> && other) : m_node(other.release()) {}
+	    ArenaRef(const ArenaRef &) = delete;
+	    ArenaRef & operator=(ArenaRef && other) {
+		m_node = other.release();
+		return *this;
+	    }
+	    template <typename U>
+	    ArenaRef & operator=(ArenaRef<U> && other) {
+		m_node = other.release();
+		return *this;
+	    }
+	    ArenaRef & operator=(const ArenaRef &) = delete;
+	    T * get() const {
+		return m_node;
+	    }
+	    T * operator->() const {
+		return m_node;
+	    }
+	    T & operator*() const {
+		return *m_node;
+	    }
+	    explicit operator bool() const {
+		return m_node != nullptr;
+	    }
+	    T * release() {
+		T * node = m_node;
+		m_node = nullptr;
+		return node;
+	    }
+	};
+
+	using NodeRef = ArenaRef<Node>;
+
+	class Arena;
 	
-	using NodeRef = std::unique_ptr<Node>;
-	
+	// Every node carries a kind tag, which backs LLVM style isa<>,
+	// cast<> and dyn_cast<> through each class's classof, so that the
+	// compiler doesn't depend on RTTI. Subclasses that have subclasses
+	// of their own occupy a contiguous range of kinds.
 	class Node {
 	public:
+	    enum class Kind {
+		Scope,
+		GlobalScope,
+		Expr,
+		Return,
+		IfElseChain,
+		MultOp,
+		DivOp,
+		ModOp,
+		AddOp,
+		SubOp,
+		LogicalAndOp,
+		LogicalOrOp,
+		EqualityOp,
+		InequalityOp,
+		Function,
+		ForLoop,
+		Ident,
+		Call,
+		Index,
+		Assign,
+		ElementAssign,
+		DeclIntVar,
+		DeclFloatVar,
+		DeclBooleanVar,
+		DeclArray,
+		Void,
+		Float,
+		Boolean,
+		Integer
+	    };
+	    Node(const Kind kind) : m_kind(kind) {}
+	    Kind GetKind() const {
+		return m_kind;
+	    }
 	    virtual llvm::Value * CodeGen(LLVMState &) = 0;
-	    virtual ~Node() {}
+	    // For bool expressions: branches to trueBlock if the
+	    // expression is true, and to falseBlock otherwise.
+	    virtual void CodeGenBranch(LLVMState &, llvm::BasicBlock * trueBlock,
+				       llvm::BasicBlock * falseBlock);
+	    // Simplifies the node's subtrees in place, before CodeGen.
+	    // Returns what should replace the node itself, e.g. the literal
+	    // a constant expression evaluates to, or null to keep it. An
+	    // empty Scope replacing a statement removes it.
+	    virtual NodeRef Fold(Arena &) {
+		return nullptr;
+	    }
+	private:
+	    const Kind m_kind;
+	};
+
+	// Bump pointer allocator for the syntax tree of one compilation
+	// unit. It must outlive every node allocated from it. The names
+	// and child arrays nodes point to are allocated from it as well.
+	// Everything it holds must be trivially destructible, since it is
+	// released without running any destructors.
+	class Arena {
+	    llvm::BumpPtrAllocator m_allocator;
+	    size_t m_nodeCount = 0;
+	public:
+	    template <typename T, typename ...Args>
+	    ArenaRef<T> Make(Args && ...args) {
+		static_assert(std::is_trivially_destructible<T>::value,
+			      "nodes are never destroyed");
+		void * memory = m_allocator.Allocate(sizeof(T), alignof(T));
+		++m_nodeCount;
+		return ArenaRef<T>(new (memory) T(std::forward<Args>(args)...));
+	    }
+	    // Moves the elements into the arena.
+	    template <typename T>
+	    llvm::MutableArrayRef<T> MakeArray(std::vector<T> && elements) {
+		static_assert(std::is_trivially_destructible<T>::value,
+			      "array elements are never destroyed");
+		T * data = m_allocator.Allocate<T>(elements.size());
+		for (size_t i = 0; i < elements.size(); ++i) {
+		    new (data + i) T(std::move(elements[i]));
+		}
+		return llvm::MutableArrayRef<T>(data, elements.size());
+	    }
+	    // The copy is NUL terminated.
+	    llvm::StringRef CopyString(llvm::StringRef text) {
+		char * data = m_allocator.Allocate<char>(text.size() + 1);
+		std::copy(text.begin(), text.end(), data);
+		data[text.size()] = '\0';
+		return llvm::StringRef(data, text.size());
+	    }
+	    size_t GetNodeCount() const {
+		return m_nodeCount;
+	    }
 	};
 	
 	class Scope : public Node {
-	    std::vector<NodeRef> m_children;
+	    llvm::MutableArrayRef<NodeRef> m_children;
 	public:
+	    Scope(llvm::MutableArrayRef<NodeRef> children = llvm::None,
+		  const Kind kind = Kind::Scope) :
+		Node(kind), m_children(children) {}
+	    static bool classof(const Node * node) {
+		return node->GetKind() == Kind::Scope ||
+		    node->GetKind() == Kind::GlobalScope;
+	    }
 	    virtual llvm::Value * CodeGen(LLVMState &) override;
-	    void AddChild(NodeRef);
-	    const std::vector<NodeRef> & GetChildren() const {
+	    virtual NodeRef Fold(Arena &) override;
+	    llvm::ArrayRef<NodeRef> GetChildren() const {
 		return m_children;
 	    }
 	};
 
 	struct GlobalScope : public Scope {
+	    GlobalScope(llvm::MutableArrayRef<NodeRef> children) :
+		Scope(children, Kind::GlobalScope) {}
+	    static bool classof(const Node * node) {
+		return node->GetKind() == Kind::GlobalScope;
+	    }
 	    virtual llvm::Value * CodeGen(LLVMState & state) override {
 		for (auto & child : this->GetChildren()) {
 		    child->CodeGen(state);
@@ -65,7 +258,7 @@ namespace coralc {
 	    }
 	};
 
-	using ScopeRef = std::unique_ptr<Scope>;
+	using ScopeRef = ArenaRef<Scope>;
 	
 	class ScopeProvider {
 	    ScopeRef m_scope;
@@ -74,18 +267,34 @@ namespace coralc {
 	    Scope & GetScope() {
 		return *m_scope;
 	    }
+	    ScopeRef TakeScope() {
+		return std::move(m_scope);
+	    }
 	};
 
 	class Expr : public Node {
-	    std::string m_type;
+	    const Type * m_type;
 	    NodeRef m_exprSubTree;
 	public:
-	    Expr(const std::string & type, NodeRef tree) :
-		m_type(type), m_exprSubTree(std::move(tree)) {}
+	    Expr(const Type * type, NodeRef tree) :
+		Node(Kind::Expr), m_type(type), m_exprSubTree(std::move(tree)) {}
+	    static bool classof(const Node * node) {
+		return node->GetKind() == Kind::Expr;
+	    }
 	    virtual llvm::Value * CodeGen(LLVMState &) override;
-	    const std::string & GetType() const {
+	    virtual void CodeGenBranch(LLVMState &, llvm::BasicBlock *,
+				       llvm::BasicBlock *) override;
+	    virtual NodeRef Fold(Arena &) override;
+	    const Type * GetType() const {
 		return m_type;
 	    }
+	    // False for the empty expression of a bare return.
+	    bool HasSubTree() const {
+		return static_cast<bool>(m_exprSubTree);
+	    }
+	    const Node & GetSubTree() const {
+		return *m_exprSubTree;
+	    }
 	};
 
 	class Return : public Node {
@@ -93,7 +302,11 @@ namespace coralc {
 	    NodeRef m_value;
 	public:
 	    Return(NodeRef);
+	    static bool classof(const Node * node) {
+		return node->GetKind() == Kind::Return;
+	    }
 	    virtual llvm::Value * CodeGen(LLVMState &) override;
+	    virtual NodeRef Fold(Arena &) override;
 	};
 
         struct Conditional : public ScopeProvider {
@@ -104,131 +317,302 @@ namespace coralc {
 
 	class IfElseChain : public Node {
 	    Conditional m_if;
-	    std::vector<Conditional> m_elseifs;
+	    llvm::MutableArrayRef<Conditional> m_elseifs;
 	    ScopeRef m_else;
 	public:
-	    IfElseChain(Conditional && _if) : m_if(std::move(_if)) {}
+	    IfElseChain(Conditional && _if, llvm::MutableArrayRef<Conditional> elseifs,
+			ScopeRef _else) :
+		Node(Kind::IfElseChain), m_if(std::move(_if)), m_elseifs(elseifs),
+		m_else(std::move(_else)) {}
+	    static bool classof(const Node * node) {
+		return node->GetKind() == Kind::IfElseChain;
+	    }
 	    virtual llvm::Value * CodeGen(LLVMState &) override;
-	    void InsertElseif(Conditional && elseif);
-	    void SetElse(ScopeRef);
+	    virtual NodeRef Fold(Arena &) override;
 	};
 
 	class BinOp : public Node {
 	protected:
-	    std::string m_resultType;
+	    const Type * m_resultType;
 	    NodeRef m_lhs, m_rhs;
 	public:
-	    BinOp(const std::string & type, NodeRef lhs, NodeRef rhs) :
-		m_resultType(type), m_lhs(std::move(lhs)), m_rhs(std::move(rhs)) {}
+	    BinOp(const Kind kind, const Type * type, NodeRef lhs, NodeRef rhs) :
+		Node(kind), m_resultType(type), m_lhs(std::move(lhs)), m_rhs(std::move(rhs)) {}
+	    static bool classof(const Node * node) {
+		return node->GetKind() >= Kind::MultOp &&
+		    node->GetKind() <= Kind::InequalityOp;
+	    }
+	    virtual NodeRef Fold(Arena &) override;
 	};
 
 	struct MultOp : public BinOp {
-	    MultOp(const std::string & type, NodeRef lhs, NodeRef rhs) :
-		BinOp(type, std::move(lhs), std::move(rhs)) {}
+	    MultOp(const Type * type, NodeRef lhs, NodeRef rhs) :
+		BinOp(Kind::MultOp, type, std::move(lhs), std::move(rhs)) {}
+	    static bool classof(const Node * node) {
+		return node->GetKind() == Kind::MultOp;
+	    }
 	    virtual llvm::Value * CodeGen(LLVMState &) override;
 	};
 
 	struct DivOp : public BinOp {
-	    DivOp(const std::string & type, NodeRef lhs, NodeRef rhs) :
-		BinOp(type, std::move(lhs), std::move(rhs)) {}
+	    DivOp(const Type * type, NodeRef lhs, NodeRef rhs) :
+		BinOp(Kind::DivOp, type, std::move(lhs), std::move(rhs)) {}
+	    static bool classof(const Node * node) {
+		return node->GetKind() == Kind::DivOp;
+	    }
 	    virtual llvm::Value * CodeGen(LLVMState &) override;
 	};
 
 	struct ModOp : public BinOp {
-	    ModOp(const std::string & type, NodeRef lhs, NodeRef rhs) :
-		BinOp(type, std::move(lhs), std::move(rhs)) {}
+	    ModOp(const Type * type, NodeRef lhs, NodeRef rhs) :
+		BinOp(Kind::ModOp, type, std::move(lhs), std::move(rhs)) {}
+	    static bool classof(const Node * node) {
+		return node->GetKind() == Kind::ModOp;
+	    }
 	    virtual llvm::Value * CodeGen(LLVMState &) override;
 	};
 
 	struct AddOp : public BinOp {
-	    AddOp(const std::string & type, NodeRef lhs, NodeRef rhs) :
-		BinOp(type, std::move(lhs), std::move(rhs)) {}
+	    AddOp(const Type * type, NodeRef lhs, NodeRef rhs) :
+		BinOp(Kind::AddOp, type, std::move(lhs), std::move(rhs)) {}
+	    static bool classof(const Node * node) {
+		return node->GetKind() == Kind::AddOp;
+	    }
 	    virtual llvm::Value * CodeGen(LLVMState &) override;
 	};
 
 	struct SubOp : public BinOp {
-	    SubOp(const std::string & type, NodeRef lhs, NodeRef rhs) :
-		BinOp(type, std::move(lhs), std::move(rhs)) {}
+	    SubOp(const Type * type, NodeRef lhs, NodeRef rhs) :
+		BinOp(Kind::SubOp, type, std::move(lhs), std::move(rhs)) {}
+	    static bool classof(const Node * node) {
+		return node->GetKind() == Kind::SubOp;
+	    }
 	    virtual llvm::Value * CodeGen(LLVMState &) override;
 	};
 
 	struct LogicalAndOp : public BinOp {
 	    LogicalAndOp(NodeRef lhs, NodeRef rhs) :
-		BinOp("bool", std::move(lhs), std::move(rhs)) {}
+		BinOp(Kind::LogicalAndOp, &Type::Bool, std::move(lhs), std::move(rhs)) {}
+	    static bool classof(const Node * node) {
+		return node->GetKind() == Kind::LogicalAndOp;
+	    }
 	    virtual llvm::Value * CodeGen(LLVMState &) override;
+	    virtual void CodeGenBranch(LLVMState &, llvm::BasicBlock *,
+				       llvm::BasicBlock *) override;
 	};
 
 	struct LogicalOrOp : public BinOp {
 	    LogicalOrOp(NodeRef lhs, NodeRef rhs) :
-		BinOp("bool", std::move(lhs), std::move(rhs)) {}
+		BinOp(Kind::LogicalOrOp, &Type::Bool, std::move(lhs), std::move(rhs)) {}
+	    static bool classof(const Node * node) {
+		return node->GetKind() == Kind::LogicalOrOp;
+	    }
 	    virtual llvm::Value * CodeGen(LLVMState &) override;
+	    virtual void CodeGenBranch(LLVMState &, llvm::BasicBlock *,
+				       llvm::BasicBlock *) override;
 	};
 	
 	struct EqualityOp : public BinOp {
-	    EqualityOp(const std::string & type, NodeRef lhs, NodeRef rhs) :
-		BinOp(type, std::move(lhs), std::move(rhs)) {}
+	    EqualityOp(const Type * type, NodeRef lhs, NodeRef rhs) :
+		BinOp(Kind::EqualityOp, type, std::move(lhs), std::move(rhs)) {}
+	    static bool classof(const Node * node) {
+		return node->GetKind() == Kind::EqualityOp;
+	    }
 	    virtual llvm::Value * CodeGen(LLVMState &) override;
 	};
 
 	struct InequalityOp : public BinOp {
-	    InequalityOp(const std::string & type, NodeRef lhs, NodeRef rhs) :
-		BinOp(type, std::move(lhs), std::move(rhs)) {}
+	    InequalityOp(const Type * type, NodeRef lhs, NodeRef rhs) :
+		BinOp(Kind::InequalityOp, type, std::move(lhs), std::move(rhs)) {}
+	    static bool classof(const Node * node) {
+		return node->GetKind() == Kind::InequalityOp;
+	    }
 	    virtual llvm::Value * CodeGen(LLVMState &) override;
 	};
 
+	struct Parameter {
+	    llvm::StringRef name;
+	    const Type * type;
+	};
+
 	class Function : public Node, public ScopeProvider {
-	    std::string m_name;
-	    std::string m_returnType;
+	    llvm::StringRef m_name;
+	    const Type * m_returnType;
+	    llvm::ArrayRef<Parameter> m_params;
+	    llvm::StringRef m_fingerprint;
+	    bool m_isCalled;
 	public:
-	    Function(ScopeRef, const std::string &, const std::string &);
+	    Function(ScopeRef, llvm::StringRef, const Type *, llvm::ArrayRef<Parameter>);
+	    // Functions called from other Coral code are defined with
+	    // internal linkage and fastcc, and exported through a thunk.
+	    void SetCalled() {
+		m_isCalled = true;
+	    }
+	    // A hash of the tokens from def to end. Functions with equal
+	    // fingerprints generate identical code.
+	    llvm::StringRef GetFingerprint() const {
+		return m_fingerprint;
+	    }
+	    void SetFingerprint(llvm::StringRef fingerprint) {
+		m_fingerprint = fingerprint;
+	    }
+	    static bool classof(const Node * node) {
+		return node->GetKind() == Kind::Function;
+	    }
 	    virtual llvm::Value * CodeGen(LLVMState &) override;
+	    virtual NodeRef Fold(Arena &) override;
 	};
 	
 	class ForLoop : public Node, public ScopeProvider {
-	    std::string m_varName;
 	    NodeRef m_decl, m_end;
 	    bool m_isReverse;
 	public:
-	    const std::string & GetIdentName() const;
+	    llvm::StringRef GetIdentName() const;
 	    ForLoop(NodeRef, NodeRef, ScopeRef, const bool);
+	    static bool classof(const Node * node) {
+		return node->GetKind() == Kind::ForLoop;
+	    }
+	    virtual llvm::Value * CodeGen(LLVMState &) override;
+	    virtual NodeRef Fold(Arena &) override;
+	};
+
+	// A direct call. The callee's signature is copied into the call,
+	// since the callee may be lowered into a different module.
+	class Call : public Node {
+	    llvm::StringRef m_name;
+	    const Type * m_returnType;
+	    llvm::ArrayRef<const Type *> m_paramTypes;
+	    llvm::MutableArrayRef<NodeRef> m_args;
+	public:
+	    Call(llvm::StringRef, const Type *, llvm::ArrayRef<const Type *>,
+		 llvm::MutableArrayRef<NodeRef>);
+	    static bool classof(const Node * node) {
+		return node->GetKind() == Kind::Call;
+	    }
 	    virtual llvm::Value * CodeGen(LLVMState &) override;
+	    virtual NodeRef Fold(Arena &) override;
+	};
+
+	// Reads an array element.
+	class Index : public Node {
+	    llvm::StringRef m_name;
+	    NodeRef m_index;
+	public:
+	    Index(llvm::StringRef, NodeRef);
+	    static bool classof(const Node * node) {
+		return node->GetKind() == Kind::Index;
+	    }
+	    virtual llvm::Value * CodeGen(LLVMState &) override;
+	    virtual NodeRef Fold(Arena &) override;
+	};
+
+	// a[i] = value;
+	class Assign : public Node {
+	    llvm::StringRef m_name;
+	    NodeRef m_value;
+	public:
+	    Assign(llvm::StringRef, NodeRef);
+	    static bool classof(const Node * node) {
+		return node->GetKind() == Kind::Assign;
+	    }
+	    virtual llvm::Value * CodeGen(LLVMState &) override;
+	    virtual NodeRef Fold(Arena &) override;
+	};
+
+	class ElementAssign : public Node {
+	    llvm::StringRef m_name;
+	    NodeRef m_index, m_value;
+	public:
+	    ElementAssign(llvm::StringRef, NodeRef, NodeRef);
+	    static bool classof(const Node * node) {
+		return node->GetKind() == Kind::ElementAssign;
+	    }
+	    virtual llvm::Value * CodeGen(LLVMState &) override;
+	    virtual NodeRef Fold(Arena &) override;
 	};
 
 	class Ident : public Node {
-	    std::string m_name;
+	    llvm::StringRef m_name;
 	public:
-	    Ident(const std::string &);
-	    const std::string & GetName() const;
+	    Ident(llvm::StringRef);
+	    static bool classof(const Node * node) {
+		return node->GetKind() == Kind::Ident;
+	    }
+	    llvm::StringRef GetName() const;
 	    virtual llvm::Value * CodeGen(LLVMState &) override;
 	};
 	
 	class DeclVar : public Node {
 	protected:
 	    NodeRef m_ident, m_value;
+	    bool m_isMutable;
+	    // Immutable variables are bound straight to the value of their
+	    // initializer. Only mutable ones get a stack slot.
+	    llvm::Value * Bind(LLVMState &, const Type &);
 	public:
-	    const std::string & GetIdentName() const {
-		return dynamic_cast<Ident &>(*m_ident).GetName();
+	    llvm::StringRef GetIdentName() const {
+		return llvm::cast<Ident>(*m_ident).GetName();
+	    }
+	    Node & GetValue() {
+		return *m_value;
+	    }
+	    bool IsMutable() const {
+		return m_isMutable;
 	    }
-	    DeclVar(NodeRef ident, NodeRef value);
+	    DeclVar(const Kind kind, NodeRef ident, NodeRef value, const bool isMutable);
+	    static bool classof(const Node * node) {
+		return node->GetKind() >= Kind::DeclIntVar &&
+		    node->GetKind() <= Kind::DeclArray;
+	    }
+	    virtual NodeRef Fold(Arena &) override;
 	};
 	
         struct DeclIntVar : public DeclVar {
-	    DeclIntVar(NodeRef, NodeRef);
+	    DeclIntVar(NodeRef, NodeRef, const bool);
+	    static bool classof(const Node * node) {
+		return node->GetKind() == Kind::DeclIntVar;
+	    }
 	    virtual llvm::Value * CodeGen(LLVMState &) override;
 	};
 
 	struct DeclFloatVar : public DeclVar {
-	    DeclFloatVar(NodeRef, NodeRef);
+	    DeclFloatVar(NodeRef, NodeRef, const bool);
+	    static bool classof(const Node * node) {
+		return node->GetKind() == Kind::DeclFloatVar;
+	    }
 	    virtual llvm::Value * CodeGen(LLVMState &) override;
 	};
 
 	struct DeclBooleanVar : public DeclVar {
-	    DeclBooleanVar(NodeRef, NodeRef);
+	    DeclBooleanVar(NodeRef, NodeRef, const bool);
+	    static bool classof(const Node * node) {
+		return node->GetKind() == Kind::DeclBooleanVar;
+	    }
+	    virtual llvm::Value * CodeGen(LLVMState &) override;
+	};
+
+	// var a = int[n]; The value is the length. A literal length gives
+	// a fixed size array in the function's frame, anything else an
+	// array on the heap that lives until its scope ends. Elements start
+	// out zero.
+	class DeclArray : public DeclVar {
+	    const Type * m_elementType;
+	    bool m_isFixedSize;
+	public:
+	    DeclArray(NodeRef, NodeRef, const bool, const Type *);
+	    static bool classof(const Node * node) {
+		return node->GetKind() == Kind::DeclArray;
+	    }
+	    virtual NodeRef Fold(Arena &) override;
 	    virtual llvm::Value * CodeGen(LLVMState &) override;
 	};
 
         struct Void : public Node {
 	public:
+	    Void() : Node(Kind::Void) {}
+	    static bool classof(const Node * node) {
+		return node->GetKind() == Kind::Void;
+	    }
 	    virtual llvm::Value * CodeGen(LLVMState &) override;
 	};
 
@@ -236,6 +620,12 @@ namespace coralc {
 	    float m_value;
 	public:
 	    Float(const float);
+	    static bool classof(const Node * node) {
+		return node->GetKind() == Kind::Float;
+	    }
+	    float GetValue() const {
+		return m_value;
+	    }
 	    virtual llvm::Value * CodeGen(LLVMState &) override;
 	};
 
@@ -243,6 +633,12 @@ namespace coralc {
 	    bool m_value;
 	public:
 	    Boolean(const bool);
+	    static bool classof(const Node * node) {
+		return node->GetKind() == Kind::Boolean;
+	    }
+	    bool GetValue() const {
+		return m_value;
+	    }
 	    virtual llvm::Value * CodeGen(LLVMState &) override;
 	};
 	
@@ -250,6 +646,12 @@ namespace coralc {
 	    int m_value;
 	public:
 	    Integer(const int);
+	    static bool classof(const Node * node) {
+		return node->GetKind() == Kind::Integer;
+	    }
+	    int GetValue() const {
+		return m_value;
+	    }
 	    virtual llvm::Value * CodeGen(LLVMState &) override;
 	};	
     }
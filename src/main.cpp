@@ -1,74 +1,191 @@
-#include "llvm/Support/TargetRegistry.h"
-#include "llvm/Target/TargetMachine.h"
-#include "llvm/Target/TargetOptions.h"
-#include "llvm/IR/LegacyPassManager.h"
-#include "llvm/Support/TargetSelect.h"
-#include "Parser.hpp"
-#include <sstream>
-#include <fstream>
+#include "llvm/ADT/Triple.h"
+#include "llvm/Support/FileSystem.h"
+#include "Driver.hpp"
+#include <cstdlib>
+#include <getopt.h>
 
 namespace coralc {
-    void GenerateCode(ast::NodeRef & root, const std::string & fname) {
-        LLVMState state;
-	try {
-	    root->CodeGen(state);
-	} catch (const std::exception & ex) {
-	    std::cerr << ex.what() << std::endl;
-	    exit(EXIT_FAILURE);
-	}
-	state.modRef->dump();
-	auto targetTriple = llvm::sys::getDefaultTargetTriple();
-	state.modRef->setTargetTriple(targetTriple);
-	std::string error;
-	auto target = llvm::TargetRegistry::lookupTarget(targetTriple, error);
-	if (!target) {
-	    std::cerr << error;
-	    return;
-	}
-	auto CPU = "generic";
-	auto features = "";
-	llvm::TargetOptions opt;
-	auto RM = llvm::Optional<llvm::Reloc::Model>();
-	auto targetMachine =
-	    target->createTargetMachine(targetTriple, CPU, features, opt, RM);
-	state.modRef->setDataLayout(targetMachine->createDataLayout());
-	auto outputName = fname + ".o";
-	std::error_code EC;
-	llvm::raw_fd_ostream dest(outputName, EC, llvm::sys::fs::F_None);
-	if (EC) {
-	    std::cerr << "Could not open file: " << EC.message();
-	    return ;
-	}
-	llvm::legacy::PassManager pass;
-	auto FileType = llvm::TargetMachine::CGFT_ObjectFile;
-	if (targetMachine->addPassesToEmitFile(pass, dest, FileType)) {
-	    std::cerr << "TheTargetMachine can't emit a file of this type";
-	    return;
-	}
-	pass.run(*state.modRef);
-	dest.flush();
+    static void PrintUsage(const char * exec) {
+	std::cerr << "usage: " << exec << " [options] <file.crl>...\n"
+		  << "options:\n"
+		  << "  -O<level>        optimization level 0-3 (default 2)\n"
+		  << "  -mcpu=<cpu>      target CPU, or native for the host (default generic)\n"
+		  << "  -march=<cpu>     alias for -mcpu\n"
+		  << "  -mattr=<a1,+a2>  target features to enable (+) or disable (-)\n"
+		  << "  --target=<triple>\n"
+		  << "                   generate code for another target (default host)\n"
+		  << "  -o <file>        output file, - for stdout (default <file.crl>.<ext>)\n"
+		  << "  -S               emit target assembly instead of an object file\n"
+		  << "  --emit-llvm      emit textual LLVM IR\n"
+		  << "  --emit-bc        emit LLVM bitcode\n"
+		  << "  --print-ir[=before-opt|after-opt]\n"
+		  << "                   print the module's IR to stderr (default before-opt)\n"
+		  << "  --run[=<fn>]     JIT compile and call fn in-process (default main)\n"
+		  << "  --cache-dir=<dir>\n"
+		  << "                   reuse outputs of identical earlier compiles stored in dir\n"
+		  << "                   (default $CORALC_CACHE_DIR, unset disables the cache)\n"
+		  << "  --cache-size=<mb>\n"
+		  << "                   evict least recently used outputs beyond this size (default 512)\n"
+		  << "  --cache-stats    print cache hits, misses and size to stderr\n"
+		  << "  --incremental    also cache each function, recompiling only changed ones\n"
+		  << "  --time-report[=<file.json>]\n"
+		  << "                   print time spent per phase and compilation statistics\n"
+		  << "                   to stderr, and as JSON to file.json (- for stdout)\n"
+		  << "  -j <n>           files (or, for one file, code generation partitions)\n"
+		  << "                   compiled in parallel, 0 for one per core (default 1);\n"
+		  << "                   partitions are linked and emitted as one module from\n"
+		  << "                   -O2 up, so that calls between them can be inlined\n";
     }
 }
 
 int main(int argc, char ** argv) {
-    llvm::InitializeAllTargetInfos();
-    llvm::InitializeAllTargets();
-    llvm::InitializeAllTargetMCs();
-    llvm::InitializeAllAsmParsers();
-    llvm::InitializeAllAsmPrinters();
-    if (argc > 1) {
-	std::ifstream t(argv[1]);
-	std::stringstream buffer;
-	buffer << t.rdbuf();
-	coralc::Parser parser;
-	try {
-	    coralc::ast::NodeRef root = parser.Parse(buffer.str());
-	    coralc::GenerateCode(root, argv[1]);
-	} catch (const std::exception & ex) {
-	    std::cerr << ex.what() << " for file " << argv[1] << std::endl;
+    coralc::CompileOptions options;
+    coralc::DriverOptions driverOptions;
+    driverOptions.compilerPath =
+	llvm::sys::fs::getMainExecutable(argv[0], reinterpret_cast<void *>(&coralc::PrintUsage));
+    if (const char * cacheDir = std::getenv("CORALC_CACHE_DIR")) {
+	driverOptions.cacheDir = cacheDir;
+    }
+    enum {
+	OPT_MCPU = 256,
+	OPT_MATTR,
+	OPT_RUN,
+	OPT_EMIT_LLVM,
+	OPT_EMIT_BC,
+	OPT_PRINT_IR,
+	OPT_TARGET,
+	OPT_CACHE_DIR,
+	OPT_CACHE_SIZE,
+	OPT_CACHE_STATS,
+	OPT_INCREMENTAL,
+	OPT_TIME_REPORT
+    };
+    static const option longOptions[] = {
+	{"mcpu", required_argument, nullptr, OPT_MCPU},
+	{"march", required_argument, nullptr, OPT_MCPU},
+	{"mattr", required_argument, nullptr, OPT_MATTR},
+	{"run", optional_argument, nullptr, OPT_RUN},
+	{"emit-llvm", no_argument, nullptr, OPT_EMIT_LLVM},
+	{"emit-bc", no_argument, nullptr, OPT_EMIT_BC},
+	{"print-ir", optional_argument, nullptr, OPT_PRINT_IR},
+	{"target", required_argument, nullptr, OPT_TARGET},
+	{"cache-dir", required_argument, nullptr, OPT_CACHE_DIR},
+	{"cache-size", required_argument, nullptr, OPT_CACHE_SIZE},
+	{"cache-stats", no_argument, nullptr, OPT_CACHE_STATS},
+	{"incremental", no_argument, nullptr, OPT_INCREMENTAL},
+	{"time-report", optional_argument, nullptr, OPT_TIME_REPORT},
+	{nullptr, 0, nullptr, 0}
+    };
+    int opt;
+    while ((opt = getopt_long_only(argc, argv, "O:o:Sj:", longOptions, nullptr)) != -1) {
+	switch (opt) {
+	case 'O':
+	    if (optarg[0] < '0' || optarg[0] > '3' || optarg[1] != '\0') {
+		std::cerr << "Invalid optimization level -O" << optarg << std::endl;
+		return EXIT_FAILURE;
+	    }
+	    options.optLevel = optarg[0] - '0';
+	    break;
+
+	case 'o':
+	    driverOptions.outputName = optarg;
+	    break;
+
+	case 'j':
+	    driverOptions.jobs = std::strtoul(optarg, nullptr, 10);
+	    break;
+
+	case 'S':
+	    driverOptions.action = coralc::DriverOptions::Action::EmitAssembly;
+	    break;
+
+	case OPT_EMIT_LLVM:
+	    driverOptions.action = coralc::DriverOptions::Action::EmitLLVM;
+	    break;
+
+	case OPT_EMIT_BC:
+	    driverOptions.action = coralc::DriverOptions::Action::EmitBitcode;
+	    break;
+
+	case OPT_PRINT_IR:
+	    if (!optarg || std::string(optarg) == "before-opt") {
+		driverOptions.printIR = coralc::DriverOptions::PrintIR::BeforeOpt;
+	    } else if (std::string(optarg) == "after-opt") {
+		driverOptions.printIR = coralc::DriverOptions::PrintIR::AfterOpt;
+	    } else {
+		std::cerr << "Invalid --print-ir mode " << optarg << std::endl;
+		return EXIT_FAILURE;
+	    }
+	    break;
+
+	case OPT_MCPU:
+	    options.cpu = optarg;
+	    break;
+
+	case OPT_MATTR:
+	    options.features = optarg;
+	    break;
+
+	case OPT_TARGET:
+	    options.triple = llvm::Triple::normalize(optarg);
+	    break;
+
+	case OPT_CACHE_DIR:
+	    driverOptions.cacheDir = optarg;
+	    break;
+
+	case OPT_CACHE_SIZE:
+	    driverOptions.cacheSize = std::strtoull(optarg, nullptr, 10) * 1024 * 1024;
+	    break;
+
+	case OPT_CACHE_STATS:
+	    driverOptions.printCacheStats = true;
+	    break;
+
+	case OPT_INCREMENTAL:
+	    driverOptions.incremental = true;
+	    break;
+
+	case OPT_TIME_REPORT:
+	    driverOptions.timeReport = true;
+	    if (optarg) {
+		driverOptions.timeReportFile = optarg;
+	    }
+	    break;
+
+	case OPT_RUN:
+	    driverOptions.action = coralc::DriverOptions::Action::Run;
+	    if (optarg) {
+		driverOptions.entry = optarg;
+	    }
+	    break;
+
+	default:
+	    coralc::PrintUsage(argv[0]);
 	    return EXIT_FAILURE;
 	}
-    } else {
-	// Print usage. Transition to getopt...
     }
+    if (driverOptions.incremental && driverOptions.cacheDir.empty()) {
+	std::cerr << "--incremental requires a cache directory" << std::endl;
+	return EXIT_FAILURE;
+    }
+    // --cache-stats alone just reports on the cache.
+    if (optind == argc && !(driverOptions.printCacheStats &&
+			    !driverOptions.cacheDir.empty())) {
+	coralc::PrintUsage(argv[0]);
+	return EXIT_FAILURE;
+    }
+    std::vector<std::string> fnames(argv + optind, argv + argc);
+    if (fnames.size() > 1 && (!driverOptions.outputName.empty() ||
+			      driverOptions.action == coralc::DriverOptions::Action::Run)) {
+	std::cerr << "-o and --run require a single input file" << std::endl;
+	return EXIT_FAILURE;
+    }
+    if (driverOptions.action == coralc::DriverOptions::Action::Run &&
+	options.triple != llvm::sys::getDefaultTargetTriple()) {
+	std::cerr << "--run can only execute code for the host target" << std::endl;
+	return EXIT_FAILURE;
+    }
+    coralc::InitializeTarget(options.triple);
+    return coralc::CompileFiles(fnames, options, driverOptions);
 }
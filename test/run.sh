@@ -0,0 +1,78 @@
+#!/bin/sh
+# Compiles, links and runs every program in this directory and checks
+# its exit status against the "// expect:" line at its top: a number,
+# trap for programs that a failed bounds check must stop, or error for
+# programs that must not compile, whose message must then contain the
+# text of an "// error:" line. Without one, the program must exit
+# with 0. "// flags:" adds coralc options,
+# and "// checks: n" requires exactly n bounds checks in the program's
+# unoptimized IR, which are the only unsigned compares coralc emits.
+#
+# usage: run.sh <coralc>
+#
+# CC selects the C compiler used to link (default clang) and OUT the
+# directory for the built programs (default test-results). Where
+# timeout(1) exists, a program that runs for more than 10 seconds
+# fails.
+
+if [ $# -lt 1 ]; then
+    echo "usage: $0 <coralc>" >&2
+    exit 1
+fi
+CORALC=$1
+CC=${CC:-clang}
+DIR=$(cd "$(dirname "$0")" && pwd)
+OUT=${OUT:-test-results}
+mkdir -p "$OUT"
+TIMEOUT=$(command -v timeout >/dev/null && echo "timeout 10")
+
+status=0
+for source in "$DIR"/*.crl; do
+    name=$(basename "$source" .crl)
+    expect=$(sed -n 's|^// expect: *||p' "$source")
+    flags=$(sed -n 's|^// flags: *||p' "$source")
+    checks=$(sed -n 's|^// checks: *||p' "$source")
+    if [ "$expect" = error ]; then
+	message=$(sed -n 's|^// error: *||p' "$source")
+	if "$CORALC" $flags -o "$OUT/$name.o" "$source" 2>"$OUT/$name.err"; then
+	    echo "FAIL $name: compiles, expected an error"
+	    status=1
+	elif ! grep -qF "$message" "$OUT/$name.err"; then
+	    echo "FAIL $name: error is not \"$message\""
+	    status=1
+	else
+	    echo "PASS $name"
+	fi
+	continue
+    fi
+    if ! "$CORALC" $flags -o "$OUT/$name.o" "$source" ||
+	    ! $CC "$OUT/$name.o" -o "$OUT/$name"; then
+	echo "FAIL $name: does not build"
+	status=1
+	continue
+    fi
+    # The shell reports programs killed by a signal on stderr.
+    { $TIMEOUT "$OUT/$name"; } 2>/dev/null
+    result=$?
+    if [ "$expect" = trap ]; then
+	# Killed by a signal.
+	passed=$([ $result -gt 128 ] && echo yes)
+    else
+	passed=$([ $result -eq "${expect:-0}" ] && echo yes)
+    fi
+    if [ -z "$passed" ]; then
+	echo "FAIL $name: exited with $result, expected ${expect:-0}"
+	status=1
+	continue
+    fi
+    if [ -n "$checks" ]; then
+	found=$("$CORALC" -O0 --emit-llvm -o - "$source" | grep -c 'icmp ult')
+	if [ "$found" -ne "$checks" ]; then
+	    echo "FAIL $name: $found bounds checks, expected $checks"
+	    status=1
+	    continue
+	fi
+    fi
+    echo "PASS $name"
+done
+exit $status